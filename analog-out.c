@@ -0,0 +1,107 @@
+// analog-out.c
+// Analog output of one channel's angle, for acquisition systems
+// that take only a voltage:
+//   RB2  PWM3 output, to be smoothed by an RC filter
+// The pin is that of the MAX7219 display's SDI, which must be off;
+// it may be used along with the quadrature output.
+//
+// PWM3 runs from Timer6 at FOSC/4 with a period of 256 ticks,
+// which gives 10 bits of duty at 62.5kHz (FOSC=64MHz) or
+// 31.25kHz (FOSC=32MHz).  A filter of a few kilohm and 100nF
+// leaves a ripple of less than one step.
+//
+// The angle, in 1/100 degree, is measured from zero the short way
+// round, so that zero is mid-scale and span covers the full scale:
+//   duty = 512 + (angle - zero) * 1024 / span
+// limited to 0..1023.  The default of zero=0, span=36000
+// puts -180 degrees at 0V and +180 degrees at VDD.
+// The duty is written as soon as the angles are known and takes
+// effect at the start of the next PWM period, so the output lags
+// the sample by little more than the filter's time constant.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "analog-out.h"
+
+#define PPS_OUT_PWM3 0x07 // PWM3OUT, from the data sheet table of RxyPPS values
+#define PWM3_TMR6 0b11 // CCPTMRS1 P3TSEL
+
+static uint8_t use_channel = 0; // 0 for A, 1 for B
+static int16_t zero_cdeg = 0;
+static int32_t span_cdeg = 36000;
+static uint16_t duty = 512;
+
+static void set_duty(uint16_t d)
+{
+    // 10 bits, left-justified across DCH and DCL<7:6>.
+    PWM3DCH = (uint8_t)(d >> 2);
+    PWM3DCL = (uint8_t)((d & 3) << 6);
+}
+
+void analog_out_init(uint8_t channel, int16_t zero, uint16_t span)
+// channel: 0 for A, 1 for B.
+// zero, span: in 1/100 degree; span 1..36000.
+{
+    use_channel = channel;
+    zero_cdeg = zero;
+    if (span < 1) { span = 1; }
+    if (span > 36000) { span = 36000; }
+    span_cdeg = span;
+    duty = 512;
+    ANSELBbits.ANSELB2 = 0; LATBbits.LATB2 = 0; TRISBbits.TRISB2 = 0;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    RB2PPS = PPS_OUT_PWM3;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+    T6CONbits.ON = 0;
+    T6HLT = 0; // Free-running mode with software gate.
+    T6CLKCONbits.CS = 0b0001; // FOSC/4
+    T6CONbits.CKPS = 0; // 1:1
+    T6CONbits.OUTPS = 0;
+    T6PR = 255;
+    T6TMR = 0;
+    CCPTMRS1bits.P3TSEL = PWM3_TMR6;
+    set_duty(duty);
+    PWM3CON = 0x80; // Enabled, active high.
+    T6CONbits.ON = 1;
+}
+
+void analog_out_close(void)
+{
+    PWM3CON = 0;
+    T6CONbits.ON = 0;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    RB2PPS = 0; // Back to LATB2.
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+    LATBbits.LATB2 = 0;
+}
+
+void analog_out_update(int16_t a_cdeg, int16_t b_cdeg)
+{
+    int32_t d = (int32_t)((use_channel) ? b_cdeg : a_cdeg) - zero_cdeg;
+    int32_t x;
+    if (d < -18000) { d += 36000; }
+    if (d > 18000) { d -= 36000; }
+    x = 512 + (d * 1024) / span_cdeg;
+    if (x < 0) { x = 0; }
+    if (x > ANALOG_OUT_FULL_SCALE) { x = ANALOG_OUT_FULL_SCALE; }
+    duty = (uint16_t)x;
+    set_duty(duty);
+}
+
+uint16_t analog_out_get_duty(void) { return duty; }
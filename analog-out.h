@@ -0,0 +1,17 @@
+// analog-out.h
+// PJ, 2026-10-18
+
+#ifndef MY_ANALOG_OUT
+#define MY_ANALOG_OUT
+
+#include <xc.h>
+#include <stdint.h>
+
+#define ANALOG_OUT_FULL_SCALE 1023 // 10-bit duty
+
+void analog_out_init(uint8_t channel, int16_t zero, uint16_t span);
+void analog_out_close(void);
+void analog_out_update(int16_t a_cdeg, int16_t b_cdeg);
+uint16_t analog_out_get_duty(void);
+
+#endif
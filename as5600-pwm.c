@@ -0,0 +1,138 @@
+// as5600-pwm.c
+// Read the AS5600 angle from its PWM output, so that the I2C bus is
+// needed only to select that output (as5600_select_pwm_output()).
+// The output is wired to RB2, since the CCP2 input can be taken only
+// from PORTB or PORTC.  RB2 is otherwise the analog output, or part
+// of the LED display, so neither may be used with the PWM input.
+//
+// CCP2 captures Timer1 at each edge, switching between rising and
+// falling edges, so the high time and the period are measured in
+// hardware to 1us (0.5us at FOSC=64MHz) with no software jitter.
+// At the default 115Hz, an AS5600 clock is 2us, so the 12-bit angle
+// is resolved.  The interrupt only notes the edges; the division that
+// turns the duty cycle into an angle is left to as5600_pwm_read(),
+// in the main loop, to keep the interrupt short for the trigger input.
+//
+// An edge is missed if interrupts are held off for longer than the
+// shortest part of the frame, 128 clocks (256us at 115Hz, but only
+// 32us at 920Hz).  The main loop holds them off for one SSI frame,
+// about 45us, so the higher PWM frequencies should not be used.
+// A missed edge is noticed from the pin level and its frame is dropped.
+//
+// The angle is that of the frame which started at the rising edge,
+// so it is up to one frame old when it is read.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "clock.h"
+#include "timestamp.h"
+#include "as5600-pwm.h"
+
+#define CCP_ON 0x80
+#define CCP_MODE_FALLING 0b0100
+#define CCP_MODE_RISING 0b0101
+
+// Edges of the frame in progress, kept by the ISR.
+static uint16_t rise_ticks, fall_ticks;
+static uint32_t rise_time;
+static uint8_t have_rise = 0, have_fall = 0;
+// The latest complete frame, written only by the ISR.
+static volatile uint16_t frame_high = 0, frame_period = 0;
+static volatile uint32_t frame_time = 0;
+static volatile uint8_t frame_count = 0;
+// Written only by as5600_pwm_read().
+static uint8_t frames_seen = 0;
+
+void as5600_pwm_init(void)
+{
+    // Expects timestamp_init() to have set up Timer1.
+    ANSELBbits.ANSELB2 = 0; TRISBbits.TRISB2 = 1; // AS5600 OUT
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    CCP2PPS = 0b01010; // RB2
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    CCPTMRSbits.C2TSEL = 0b01; // Capture Timer1
+    CCP2CONbits.EN = 0;
+    CCP2CONbits.MODE = CCP_MODE_RISING;
+    have_rise = 0; have_fall = 0;
+    frame_count = 0; frames_seen = 0;
+    PIR6bits.CCP2IF = 0;
+    PIE6bits.CCP2IE = 1;
+    CCP2CONbits.EN = 1;
+}
+
+void as5600_pwm_close(void)
+{
+    PIE6bits.CCP2IE = 0;
+    CCP2CONbits.EN = 0;
+    PIR6bits.CCP2IF = 0;
+}
+
+void as5600_pwm_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    // A rising edge that follows a rise and a fall completes a frame.
+    uint16_t ticks;
+    uint32_t t;
+    if (!(PIE6bits.CCP2IE && PIR6bits.CCP2IF)) return;
+    ticks = CCPR2;
+    if (CCP2CONbits.MODE == CCP_MODE_RISING) {
+        t = timestamp_extend(ticks, timestamp_now());
+        if (have_fall && (t - rise_time) < AS5600_PWM_MAX_PERIOD_US) {
+            frame_high = fall_ticks - rise_ticks;
+            frame_period = ticks - rise_ticks;
+            frame_time = rise_time;
+            frame_count++;
+        }
+        rise_ticks = ticks;
+        rise_time = t;
+        have_rise = 1; have_fall = 0;
+        // Changing the mode may raise a false capture, so the flag
+        // is cleared after it.  If the pin is already low by then,
+        // the falling edge has gone by without being captured.
+        CCP2CON = CCP_ON | CCP_MODE_FALLING;
+        PIR6bits.CCP2IF = 0;
+        if (!PORTBbits.RB2) { have_rise = 0; }
+    } else {
+        fall_ticks = ticks;
+        have_fall = have_rise;
+        CCP2CON = CCP_ON | CCP_MODE_RISING;
+        PIR6bits.CCP2IF = 0;
+        if (PORTBbits.RB2) { have_rise = 0; have_fall = 0; }
+    }
+}
+
+uint8_t as5600_pwm_read(uint16_t* raw, uint32_t* t_angle)
+// Returns 1 with the angle of the latest complete frame and the time
+// (us) at which that frame started, if a frame has completed since the
+// previous call.  Otherwise returns 0 and leaves *raw and *t_angle alone.
+{
+    uint16_t high, period;
+    uint32_t t, x;
+    uint8_t count;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    count = frame_count;
+    high = frame_high;
+    period = frame_period;
+    t = frame_time;
+    INTCONbits.GIE = GIEBitValue;
+    if (count == frames_seen) return 0;
+    frames_seen = count;
+    if (period < AS5600_PWM_MIN_PERIOD_TICKS || period > AS5600_PWM_MAX_PERIOD_TICKS ||
+        high >= period) return 0;
+    // High time in AS5600 clocks, rounded, and then limited to the
+    // range that a good frame can have.
+    x = ((uint32_t)high * AS5600_PWM_FRAME_CLOCKS + period/2) / period;
+    if (x < AS5600_PWM_HEAD_CLOCKS) { x = AS5600_PWM_HEAD_CLOCKS; }
+    if (x > AS5600_PWM_HEAD_CLOCKS + 4095) { x = AS5600_PWM_HEAD_CLOCKS + 4095; }
+    *raw = (uint16_t)(x - AS5600_PWM_HEAD_CLOCKS);
+    *t_angle = t;
+    return 1;
+}
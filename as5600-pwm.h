@@ -0,0 +1,28 @@
+// as5600-pwm.h
+// PJ, 2026-10-18
+
+#ifndef MY_AS5600_PWM
+#define MY_AS5600_PWM
+
+#include <xc.h>
+#include <stdint.h>
+#include "clock.h"
+
+// A PWM frame is 4351 AS5600 clocks: 128 high, then high for as many
+// clocks as the angle (0 to 4095), then low for the rest.
+#define AS5600_PWM_FRAME_CLOCKS 4351
+#define AS5600_PWM_HEAD_CLOCKS 128
+
+// Frames outside these periods are not used.  They allow for the
+// tolerance of the AS5600 oscillator at 115Hz (8.7ms) through 920Hz.
+#define AS5600_PWM_MIN_PERIOD_US 900
+#define AS5600_PWM_MAX_PERIOD_US 10000
+#define AS5600_PWM_MIN_PERIOD_TICKS ((uint16_t)(AS5600_PWM_MIN_PERIOD_US << TIMESTAMP_SHIFT))
+#define AS5600_PWM_MAX_PERIOD_TICKS ((uint16_t)(AS5600_PWM_MAX_PERIOD_US << TIMESTAMP_SHIFT))
+
+void as5600_pwm_init(void);
+void as5600_pwm_close(void);
+void as5600_pwm_service_irq(void);
+uint8_t as5600_pwm_read(uint16_t* raw, uint32_t* t_angle);
+
+#endif
@@ -0,0 +1,141 @@
+// as5600.c
+// Read the AS5600 magnetic encoder over I2C1.
+// When RAW ANGLE is read from its high byte, the AS5600 leaves its
+// address pointer there, so once the pointer has been written each
+// sample needs only a 2-byte read, about half the bus time of
+// writing the pointer every time.
+// The time at which each angle was taken is returned with it,
+// so that it can be related to the SSI channel's latch time.
+//
+// With the magnet checked (the default), each sample is instead one
+// transaction that reads STATUS and RAW ANGLE together, and AGC and
+// MAGNITUDE are read only once in AS5600_HEALTH_EVERY samples.
+// An angle read while STATUS shows no magnet, or one too weak or
+// too strong, is not used.
+//
+// The OUT pin can instead be set to give the angle as PWM at 115Hz,
+// for as5600-pwm.c to measure without using the bus.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "i2c.h"
+#include "timestamp.h"
+#include "as5600.h"
+
+static uint8_t pointer_set = 0;
+static uint8_t check_magnet = 1;
+static uint8_t status = 0;
+static uint8_t agc = 0;
+static uint16_t magnitude = 0;
+static uint8_t health_count = 0;
+
+void as5600_init(void)
+{
+    // i2c1_init() must have been called.
+    // The pointer is written with the first read.
+    pointer_set = 0;
+    health_count = 0;
+}
+
+void as5600_set_check_magnet(uint8_t on)
+{
+    check_magnet = on;
+    pointer_set = 0; // The burst reads leave it elsewhere.
+    health_count = 0;
+}
+
+uint8_t as5600_get_check_magnet(void) { return check_magnet; }
+uint8_t as5600_get_status(void) { return status; }
+uint8_t as5600_get_agc(void) { return agc; }
+uint16_t as5600_get_magnitude(void) { return magnitude; }
+
+uint8_t as5600_magnet_ok(void)
+// According to the latest STATUS; always 1 when the magnet is not checked.
+{
+    if (!check_magnet) return 1;
+    return (status & (AS5600_STATUS_MD | AS5600_STATUS_ML | AS5600_STATUS_MH)) == AS5600_STATUS_MD;
+}
+
+static uint8_t read_with_status(uint16_t* raw, uint32_t* t_angle)
+{
+    uint8_t buf[3];
+    uint8_t err;
+    uint32_t t0 = timestamp_now();
+    i2c1_read_register(AS5600_ADDR, AS5600_STATUS, 3, buf);
+    err = i2c1_get_error_flag();
+    if (err) return err;
+    status = buf[0];
+    if (as5600_magnet_ok()) {
+        *raw = ((uint16_t)(buf[1] & 0x0f) << 8) | (uint16_t)buf[2];
+        *t_angle = t0 + AS5600_BURST_LATCH_US;
+    }
+    if (++health_count >= AS5600_HEALTH_EVERY) {
+        health_count = 0;
+        i2c1_read_register(AS5600_ADDR, AS5600_AGC, 3, buf);
+        err = i2c1_get_error_flag();
+        if (err) return err;
+        agc = buf[0];
+        magnitude = ((uint16_t)(buf[1] & 0x0f) << 8) | (uint16_t)buf[2];
+    }
+    return 0;
+}
+
+uint8_t as5600_read_raw_angle(uint16_t* raw, uint32_t* t_angle)
+// Returns the i2c1 error code, 0 on success.
+// On failure, or with a bad magnet, *raw and *t_angle are left alone.
+// After a failure the pointer is written again, in case the AS5600 lost it.
+{
+    uint8_t buf[2];
+    uint8_t err;
+    uint32_t t0;
+    if (check_magnet) return read_with_status(raw, t_angle);
+    if (!pointer_set) {
+        buf[0] = AS5600_RAW_ANGLE_H;
+        i2c1_write(AS5600_ADDR, 1, buf);
+        err = i2c1_get_error_flag();
+        if (err) return err;
+        pointer_set = 1;
+    }
+    t0 = timestamp_now();
+    i2c1_read(AS5600_ADDR, 2, buf);
+    err = i2c1_get_error_flag();
+    if (err) {
+        pointer_set = 0;
+        return err;
+    }
+    *raw = ((uint16_t)(buf[0] & 0x0f) << 8) | (uint16_t)buf[1];
+    *t_angle = t0 + AS5600_LATCH_US;
+    return 0;
+}
+
+uint8_t as5600_select_pwm_output(void)
+// Set the OUT pin to PWM at 115Hz, keeping the other CONF settings.
+// The setting is not burned, so it is made after every power-up.
+// Returns the i2c1 error code, 0 on success.
+{
+    uint8_t buf[2];
+    uint8_t err;
+    pointer_set = 0;
+    i2c1_read_register(AS5600_ADDR, AS5600_CONF_L, 1, &buf[1]);
+    err = i2c1_get_error_flag();
+    if (err) return err;
+    buf[0] = AS5600_CONF_L;
+    buf[1] = (buf[1] & ~(AS5600_CONF_OUTS_MASK | AS5600_CONF_PWMF_MASK)) | AS5600_CONF_OUTS_PWM;
+    i2c1_write(AS5600_ADDR, 2, buf);
+    return i2c1_get_error_flag();
+}
+
+uint16_t as5600_interpolate(uint16_t a0, uint32_t t0, uint16_t a1, uint32_t t1, uint32_t t)
+// Estimate the 12-bit angle at time t from readings a0 at t0 and a1 at t1,
+// the short way round.  Meant for t a little after t1, such as the
+// SSI latch that follows the AS5600 read.
+// Readings that are not in order or more than a second apart give a1.
+{
+    uint32_t span = t1 - t0;
+    if (span == 0 || span > 1000000UL) return a1;
+    int16_t d = (int16_t)((a1 - a0 + 2048) & 0x0fff) - 2048;
+    int32_t step = (int32_t)d * (int32_t)(t - t1) / (int32_t)span;
+    return (uint16_t)((int32_t)a1 + step) & 0x0fff;
+}
@@ -0,0 +1,48 @@
+// as5600.h
+// PJ, 2026-10-18
+
+#ifndef MY_AS5600
+#define MY_AS5600
+
+#include <stdint.h>
+#include "clock.h"
+
+#define AS5600_ADDR 0x36
+#define AS5600_STATUS 0x0b
+#define AS5600_RAW_ANGLE_H 0x0c
+#define AS5600_AGC 0x1a // followed by MAGNITUDE high and low bytes
+#define AS5600_CONF_L 0x08
+
+// CONF low-byte fields
+#define AS5600_CONF_OUTS_MASK 0x30 // output stage
+#define AS5600_CONF_OUTS_PWM 0x20
+#define AS5600_CONF_PWMF_MASK 0xc0 // PWM frequency; 0 for 115Hz
+
+// STATUS bits
+#define AS5600_STATUS_MH 0x08 // magnet too strong
+#define AS5600_STATUS_ML 0x10 // magnet too weak
+#define AS5600_STATUS_MD 0x20 // magnet detected
+
+// With the magnet checked, AGC and MAGNITUDE are read once
+// in this many samples.
+#define AS5600_HEALTH_EVERY 20
+
+// The AS5600 loads its angle for sending as the byte before it ends.
+// For the plain read, that is the start condition and address byte,
+// about 10 bit-times into the read; for the burst from STATUS, the
+// register write, repeated start, address and STATUS bytes, about 38.
+#define AS5600_LATCH_US (10 * 1000000L / I2C1_CLOCK_HZ)
+#define AS5600_BURST_LATCH_US (38 * 1000000L / I2C1_CLOCK_HZ)
+
+void as5600_init(void);
+void as5600_set_check_magnet(uint8_t on);
+uint8_t as5600_get_check_magnet(void);
+uint8_t as5600_read_raw_angle(uint16_t* raw, uint32_t* t_angle);
+uint8_t as5600_magnet_ok(void);
+uint8_t as5600_get_status(void);
+uint8_t as5600_get_agc(void);
+uint16_t as5600_get_magnitude(void);
+uint8_t as5600_select_pwm_output(void);
+uint16_t as5600_interpolate(uint16_t a0, uint32_t t0, uint16_t a1, uint32_t t1, uint32_t t);
+
+#endif
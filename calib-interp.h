@@ -0,0 +1,34 @@
+// calib-interp.h
+// Correction of a sensor's nonlinearity from a table of CALIB_POINTS
+// values, evenly spaced around the turn, by linear interpolation.
+// The position is given as 16 bits per turn; its top bits pick the
+// segment and the rest are the fraction across it.  The table wraps,
+// so the last segment runs from the last point back to the first.
+//
+// The work is the same for every position: one 16x16-bit multiply
+// and a shift, with no loop and no division.
+// This header is plain C, so that the host tools (host/calib-fit.cpp,
+// host/calib-bench.cpp) use the same arithmetic as the firmware.
+// PJ, 2026-10-18
+
+#ifndef MY_CALIB_INTERP
+#define MY_CALIB_INTERP
+
+#include <stdint.h>
+
+#define CALIB_POINTS 64
+#define CALIB_INDEX_BITS 6 // log2(CALIB_POINTS)
+#define CALIB_FRAC_BITS (16 - CALIB_INDEX_BITS)
+
+static inline int16_t calib_interp(const int16_t* table, uint16_t pos16)
+// Returns the correction at pos16, in the units of the table.
+{
+    uint8_t i = (uint8_t)(pos16 >> CALIB_FRAC_BITS);
+    int32_t f = (int32_t)(pos16 & ((1u << CALIB_FRAC_BITS) - 1));
+    int16_t c0 = table[i];
+    int16_t c1 = table[(i + 1) & (CALIB_POINTS - 1)];
+    int32_t step = ((int32_t)(c1 - c0) * f + (1L << (CALIB_FRAC_BITS - 1))) >> CALIB_FRAC_BITS;
+    return (int16_t)(c0 + step);
+}
+
+#endif
@@ -0,0 +1,72 @@
+// calib.c
+// Per-channel correction of the sensors' nonlinearity.
+// The AS5600 and AEAT sensors, with a magnet that is not quite centred
+// or not quite uniform, read with errors of some tenths of a degree
+// that repeat each turn.  A table of corrections for each channel,
+// in 1/100 degree at CALIB_POINTS positions of the raw reading,
+// is kept in EEPROM and interpolated (calib-interp.h) in the sample path.
+//
+// The reading is relative to the reference, so the main loop adds the
+// correction at the raw reading and takes off that at the reference.
+// Tables are fitted on the host from a sweep against a reference
+// encoder (host/calib-fit.cpp) and sent with the N command.
+// With a freshly-programmed chip, the enable bytes read 0xff and
+// no correction is made.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "eeprom.h"
+#include "calib.h"
+
+static int16_t table[2][CALIB_POINTS];
+static uint8_t enabled[2];
+
+static uint16_t point_addr(uint8_t ch, uint8_t i)
+{
+    return EE_ADDR_CALIB_TABLE + ((uint16_t)ch * CALIB_POINTS + i) * 2;
+}
+
+void calib_init(void)
+{
+    // Copy the tables to RAM, so that the sample path reads no EEPROM.
+    for (uint8_t ch=0; ch < 2; ++ch) {
+        enabled[ch] = (DATAEE_ReadByte(EE_ADDR_CALIB_ENABLE + ch) == 1);
+        for (uint8_t i=0; i < CALIB_POINTS; ++i) {
+            uint16_t addr = point_addr(ch, i);
+            table[ch][i] = (int16_t)((uint16_t)(DATAEE_ReadByte(addr+1) << 8) | DATAEE_ReadByte(addr));
+        }
+    }
+}
+
+void calib_set_enabled(uint8_t ch, uint8_t on)
+{
+    if (ch > 1) return;
+    enabled[ch] = on;
+    DATAEE_WriteByte(EE_ADDR_CALIB_ENABLE + ch, on);
+}
+
+uint8_t calib_get_enabled(uint8_t ch) { return (ch > 1) ? 0 : enabled[ch]; }
+
+void calib_set_point(uint8_t ch, uint8_t i, int16_t cdeg)
+{
+    uint16_t addr;
+    if (ch > 1 || i >= CALIB_POINTS) return;
+    addr = point_addr(ch, i);
+    table[ch][i] = cdeg;
+    DATAEE_WriteByte(addr, (uint8_t)((uint16_t)cdeg & 0xff));
+    DATAEE_WriteByte(addr+1, (uint8_t)((uint16_t)cdeg >> 8));
+}
+
+int16_t calib_get_point(uint8_t ch, uint8_t i)
+{
+    return (ch > 1 || i >= CALIB_POINTS) ? 0 : table[ch][i];
+}
+
+int16_t calib_correction(uint8_t ch, uint16_t raw, uint8_t nbits)
+// Correction, in 1/100 degree, for a raw reading of nbits.
+{
+    if (ch > 1 || !enabled[ch]) return 0;
+    return calib_interp(table[ch], (uint16_t)(raw << (16 - nbits)));
+}
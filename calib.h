@@ -0,0 +1,17 @@
+// calib.h
+// PJ, 2026-10-18
+
+#ifndef MY_CALIB
+#define MY_CALIB
+
+#include <stdint.h>
+#include "calib-interp.h"
+
+void calib_init(void);
+void calib_set_enabled(uint8_t ch, uint8_t on);
+uint8_t calib_get_enabled(uint8_t ch);
+void calib_set_point(uint8_t ch, uint8_t i, int16_t cdeg);
+int16_t calib_get_point(uint8_t ch, uint8_t i);
+int16_t calib_correction(uint8_t ch, uint16_t raw, uint8_t nbits);
+
+#endif
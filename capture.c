@@ -0,0 +1,194 @@
+// capture.c
+// Burst capture of raw encoder samples into a packed ring buffer in RAM.
+//
+// Once armed, the main loop reads the SSI encoders as fast as it can,
+// holding off interrupts only for each frame, and passes every sample
+// to capture_store().  The interrupt service routine keeps running
+// between frames, so the clocks, the UART and the trigger input are
+// served as usual during the burst.
+// When armed to wait for the trigger input, the ring is overwritten
+// continuously until an edge arrives and then half a buffer more is taken,
+// so that we keep samples from both before and after the edge.
+// The edge itself is latched and recorded by the trigger interrupt,
+// as at any other time; we note only where it fell in the ring.
+// The samples after the edge (or all of them, without the trigger)
+// stop early if they would take longer than CAPTURE_MAX_BURST_US.
+// Any character arriving from the host abandons a capture that is
+// still waiting for its trigger.
+//
+// Samples are bit-packed, A then B, most-significant bit first:
+//   2x16 bits in 4 bytes, 2x12 bits in 3 bytes,
+//   two samples of 2x10 bits in 5 bytes.
+// The buffer is later sent to the host as lines of hex text,
+// one line per pass of the main loop so that normal output continues.
+// See host/capture-unpack.cpp for the unpacking.
+//
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "global_defs.h"
+#include "timestamp.h"
+#include "trigger.h"
+#include "uart.h"
+#include "capture.h"
+
+#define CAPTURE_IDLE 0
+#define CAPTURE_WAIT_TRIGGER 1
+#define CAPTURE_RUNNING 2
+#define CAPTURE_DONE 3
+#define CAPTURE_DUMPING 4
+
+#define DUMP_BYTES_PER_LINE 32
+
+static uint8_t buf[CAPTURE_NBYTES];
+static uint8_t state = CAPTURE_IDLE;
+static uint8_t nbits;
+static uint8_t samples_per_slot;
+static uint8_t slot_bytes;
+static uint16_t ring_bytes;
+static uint16_t capacity; // in samples
+static uint16_t wr; // ring position for the next sample
+static uint16_t count; // samples held in the ring
+static uint16_t remaining; // samples still to be taken
+static uint16_t trigger_pos; // ring position of the sample following the edge
+static uint32_t total; // samples taken, including those overwritten
+static uint32_t t_start, t_end;
+static uint32_t t_run; // start of the part of the burst that is bounded
+static uint16_t edges_at_arm; // trigger edge count when armed
+static uint16_t dump_offset, dump_nbytes, dump_first;
+
+void capture_arm(uint8_t nbits_, uint8_t on_trigger)
+{
+    nbits = nbits_;
+    if (nbits <= 10) {
+        nbits = 10; slot_bytes = 5; samples_per_slot = 2;
+    } else if (nbits <= 12) {
+        nbits = 12; slot_bytes = 3; samples_per_slot = 1;
+    } else {
+        nbits = 16; slot_bytes = 4; samples_per_slot = 1;
+    }
+    ring_bytes = (CAPTURE_NBYTES / slot_bytes) * slot_bytes;
+    capacity = (ring_bytes / slot_bytes) * samples_per_slot;
+    wr = 0; count = 0; total = 0;
+    trigger_pos = 0xffff;
+    edges_at_arm = trigger_get_edge_count();
+    if (on_trigger) {
+        remaining = capacity / 2;
+        state = CAPTURE_WAIT_TRIGGER;
+    } else {
+        remaining = capacity;
+        state = CAPTURE_RUNNING;
+    }
+}
+
+uint8_t capture_is_armed(void)
+{
+    return (state == CAPTURE_WAIT_TRIGGER || state == CAPTURE_RUNNING);
+}
+
+static void pack(uint16_t i, uint16_t a, uint16_t b)
+{
+    uint8_t* p;
+    if (nbits == 16) {
+        p = &buf[i*4];
+        p[0] = (uint8_t)(a >> 8); p[1] = (uint8_t)a;
+        p[2] = (uint8_t)(b >> 8); p[3] = (uint8_t)b;
+    } else if (nbits == 12) {
+        p = &buf[i*3];
+        p[0] = (uint8_t)(a >> 4);
+        p[1] = (uint8_t)(a << 4) | (uint8_t)((b >> 8) & 0x0f);
+        p[2] = (uint8_t)b;
+    } else {
+        p = &buf[(i >> 1)*5];
+        if ((i & 1) == 0) {
+            p[0] = (uint8_t)(a >> 2);
+            p[1] = (uint8_t)(a << 6) | (uint8_t)((b >> 4) & 0x3f);
+            p[2] = (p[2] & 0x0f) | (uint8_t)(b << 4);
+        } else {
+            p[2] = (p[2] & 0xf0) | (uint8_t)((a >> 6) & 0x0f);
+            p[3] = (uint8_t)(a << 2) | (uint8_t)((b >> 8) & 0x03);
+            p[4] = (uint8_t)b;
+        }
+    }
+}
+
+uint8_t capture_store(uint16_t a, uint16_t b)
+// Returns 1 while more samples are wanted.
+{
+    int c;
+    uint32_t t = timestamp_now();
+    if (total == 0) { t_start = t; t_run = t; }
+    pack(wr, a, b);
+    if (++wr == capacity) { wr = 0; }
+    if (count < capacity) { count++; }
+    total++;
+    if (state == CAPTURE_WAIT_TRIGGER) {
+        if (trigger_get_edge_count() != edges_at_arm) {
+            trigger_pos = wr;
+            t_run = t;
+            state = CAPTURE_RUNNING;
+        } else if ((c = uart1_peekc_nowait()) >= 0) {
+            if (c == '\r' || c == '\n') {
+                // The end of the line that armed us, which
+                // command_poll() would ignore anyway.
+                uart1_getc_nowait();
+            } else {
+                // The host wants our attention.
+                state = CAPTURE_IDLE;
+                return 0;
+            }
+        }
+        return 1;
+    }
+    if (remaining) { remaining--; }
+    if (t - t_run >= CAPTURE_MAX_BURST_US) { remaining = 0; }
+    // Stop on a slot boundary so that the dump is whole slots.
+    if (remaining == 0 && (wr % samples_per_slot) == 0) {
+        t_end = timestamp_now();
+        state = CAPTURE_DONE;
+        return 0;
+    }
+    return 1;
+}
+
+uint8_t capture_dump_start(void)
+// Returns 0 if there is no completed capture to send.
+{
+    uint16_t oldest, trig_index;
+    if (state != CAPTURE_DONE && state != CAPTURE_DUMPING) return 0;
+    oldest = (count < capacity) ? 0 : wr;
+    trig_index = (trigger_pos == 0xffff) ? 0xffff :
+        (uint16_t)((trigger_pos + capacity - oldest) % capacity);
+    dump_first = (oldest / samples_per_slot) * slot_bytes;
+    dump_nbytes = (count / samples_per_slot) * slot_bytes;
+    dump_offset = 0;
+    // nbits, samples, trigger index, samples taken, start and end times (us)
+    printf("D,%u,%u,%u,%lu,%lu,%lu\r\n", nbits, count, trig_index,
+           total, t_start, t_end);
+    state = CAPTURE_DUMPING;
+    return 1;
+}
+
+uint8_t capture_dump_next(void)
+// Sends the next line of the dump, if any.
+// Returns 1 while there is more to send.
+{
+    uint16_t k;
+    if (state != CAPTURE_DUMPING) return 0;
+    if (dump_offset >= dump_nbytes) {
+        printf("D,end\r\n");
+        state = CAPTURE_DONE;
+        return 0;
+    }
+    printf("D:");
+    for (uint8_t i=0; i < DUMP_BYTES_PER_LINE && dump_offset < dump_nbytes; ++i) {
+        k = dump_first + dump_offset;
+        if (k >= ring_bytes) { k -= ring_bytes; }
+        printf("%02x", buf[k]);
+        dump_offset++;
+    }
+    printf("\r\n");
+    return 1;
+}
@@ -0,0 +1,26 @@
+// capture.h
+// PJ, 2026-10-18
+
+#ifndef MY_CAPTURE
+#define MY_CAPTURE
+
+#include <stdint.h>
+
+// Size of the RAM ring buffer.  It holds 600 samples of 2x10 bits,
+// 500 samples of 2x12 bits or 375 samples of 2x16 bits.
+#define CAPTURE_NBYTES 1500
+
+// Longest burst, in microseconds, from its first sample or, for CT,
+// from the trigger edge.  It is kept below the span of Timer1 at
+// FOSC=64MHz (32.7ms, see timestamp_extend()), so that no burst
+// outlasts one turn of Timer1, and the main loop is held up by no
+// more than about a cycle once the edge has come.
+#define CAPTURE_MAX_BURST_US 30000L
+
+void capture_arm(uint8_t nbits, uint8_t on_trigger);
+uint8_t capture_is_armed(void);
+uint8_t capture_store(uint16_t a, uint16_t b);
+uint8_t capture_dump_start(void);
+uint8_t capture_dump_next(void);
+
+#endif
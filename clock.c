@@ -0,0 +1,13 @@
+// clock.c
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include "global_defs.h"
+#include "clock.h"
+
+void clock_init(void)
+{
+    // The configuration bits start us on HFINTOSC at 64MHz.
+    OSCFRQbits.HFFRQ = CLOCK_HFFRQ;
+    while (!OSCSTATbits.HFOR) { CLRWDT(); } // Wait for the new frequency.
+}
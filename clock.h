@@ -0,0 +1,76 @@
+// clock.h
+// Selection of the system clock and the peripheral settings derived
+// from it at compile time.  Settings that the clock cannot make
+// stop the build, rather than leave us with the wrong rates at run time.
+// PJ, 2026-10-18
+
+#ifndef MY_CLOCK
+#define MY_CLOCK
+
+#include "global_defs.h"
+
+// HFINTOSC frequency selection.
+#if FOSC == 32000000L
+#define CLOCK_HFFRQ 0b0110
+#elif FOSC == 64000000L
+#define CLOCK_HFFRQ 0b1000
+#else
+#error "FOSC must be 32000000L or 64000000L"
+#endif
+
+// MSSP1 as I2C master: clock = FOSC/(4*(SSP1ADD+1))
+// 0x4f at 32MHz, 0x9f at 64MHz.
+#define I2C1_CLOCK_HZ 100000L
+#define I2C1_SSPADD (FOSC/(4*I2C1_CLOCK_HZ) - 1)
+#if I2C1_SSPADD < 3 || I2C1_SSPADD > 255
+#error "I2C1 clock cannot be made from FOSC"
+#endif
+
+// MSSP2 as SPI master: clock = FOSC/(4*(SSP2ADD+1)),
+// 500kHz, as we had with FOSC/64 at 32MHz.
+#define SPI2_CLOCK_HZ 500000L
+#define SPI2_SSPADD (FOSC/(4*SPI2_CLOCK_HZ) - 1)
+#if SPI2_SSPADD < 3 || SPI2_SSPADD > 255
+#error "SPI2 clock cannot be made from FOSC"
+#endif
+
+// EUSART1 with BRG16=1, BRGH=1: baud = FOSC/(4*(SP1BRG+1))
+// Other rates are checked at run time by uart1_check_baud().
+#define UART1_DEFAULT_BAUD 115200L
+#define UART1_BRG_FOR(baud) ((FOSC/4 + (baud)/2)/(baud) - 1)
+#define UART1_ACTUAL_BAUD(baud) ((FOSC/4)/(UART1_BRG_FOR(baud) + 1))
+#if UART1_BRG_FOR(UART1_DEFAULT_BAUD) > 65535
+#error "Default baud rate is too slow for FOSC"
+#endif
+#if (UART1_ACTUAL_BAUD(UART1_DEFAULT_BAUD) - UART1_DEFAULT_BAUD)*50 > UART1_DEFAULT_BAUD || \
+    (UART1_DEFAULT_BAUD - UART1_ACTUAL_BAUD(UART1_DEFAULT_BAUD))*50 > UART1_DEFAULT_BAUD
+#error "Default baud rate cannot be made to within 2% from FOSC"
+#endif
+
+// Timer1, FOSC/4 with 1:8 prescale, is the timestamp clock.
+// Its ticks are shifted down to microseconds.
+#define TIMESTAMP_SHIFT ((FOSC/4/8)/1000000L - 1)
+#if (FOSC/4/8) != (1000000L << TIMESTAMP_SHIFT)
+#error "Timer1 ticks cannot be made into microseconds"
+#endif
+
+// Timer4, FOSC/4 with this prescale, ticks once per microsecond.
+#if FOSC == 32000000L
+#define TIMER4_CKPS_1US 0b011 // 1:8
+#else
+#define TIMER4_CKPS_1US 0b100 // 1:16
+#endif
+
+// Timer4, FOSC/4 with no prescale and a period of this many ticks,
+// paces the sampling of the incremental encoder input (quad-in.c).
+#define QUAD_IN_SAMPLE_HZ 4000000L
+#define QUAD_IN_SAMPLE_PR (FOSC/4/QUAD_IN_SAMPLE_HZ - 1)
+#if (FOSC/4) != QUAD_IN_SAMPLE_HZ*(QUAD_IN_SAMPLE_PR + 1)
+#error "Incremental input sample rate cannot be made from FOSC"
+#endif
+
+// Timer2 runs from MFINTOSC (31kHz), so its period does not depend on FOSC.
+
+void clock_init(void);
+
+#endif
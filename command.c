@@ -0,0 +1,51 @@
+// command.c
+// Assemble command lines sent by the host over UART1.
+// Each command is a line of text, terminated by \r or \n,
+// with the first character selecting the command.
+// The main loop calls command_poll() once per pass, so
+// a command is acted upon at a cycle boundary.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "uart.h"
+#include "command.h"
+
+static char line[COMMAND_LEN];
+static uint8_t nchars = 0;
+
+uint8_t command_poll(char* cmd)
+// Returns 1 and copies a null-terminated command into cmd
+// (which must hold COMMAND_LEN characters) when a complete line has arrived.
+// Overlong lines are truncated.
+{
+    int c;
+    while ((c = uart1_getc_nowait()) >= 0) {
+        if (c == '\r' || c == '\n') {
+            if (nchars == 0) continue; // Ignore blank lines.
+            for (uint8_t i=0; i < nchars; ++i) { cmd[i] = line[i]; }
+            cmd[nchars] = 0;
+            nchars = 0;
+            return 1;
+        }
+        if (nchars < COMMAND_LEN-1) { line[nchars++] = (char)c; }
+    }
+    return 0;
+}
+
+uint8_t command_parse_args(const char* cmd, long* vals, uint8_t nmax)
+// Parse up to nmax comma-separated decimal numbers that follow
+// the command letter, as in "Q4,4,20".  Returns the number found.
+{
+    uint8_t n = 0;
+    const char* p = cmd + 1;
+    while (*p && n < nmax) {
+        if (*p == ',') { p++; continue; }
+        if (!(*p == '-' || (*p >= '0' && *p <= '9'))) break;
+        vals[n++] = atol(p);
+        if (*p == '-') p++;
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    return n;
+}
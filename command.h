@@ -0,0 +1,14 @@
+// command.h
+// PJ, 2026-10-18
+
+#ifndef MY_COMMAND
+#define MY_COMMAND
+
+#include <stdint.h>
+
+#define COMMAND_LEN 24
+
+uint8_t command_poll(char* cmd);
+uint8_t command_parse_args(const char* cmd, long* vals, uint8_t nmax);
+
+#endif
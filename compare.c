@@ -0,0 +1,152 @@
+// compare.c
+// Position-compare outputs, one per channel, that act as limit switches:
+//   A  RB6
+//   B  RB7
+// Each output is high while its channel's angle is within a window,
+// which is kept in EEPROM so that the switches work from reset.
+// Once inside, the window is widened by the hysteresis on each side,
+// so that jitter at an edge does not make the output chatter.
+//
+// The outputs are set as soon as the angles are known, ahead of the
+// UART and display output, and the time from the sample (SSI latch)
+// to the pins being written is measured every cycle and reported,
+// with the most seen, as
+//   L,en_a,lo_a,hi_a,hyst_a,inside_a,en_b,lo_b,hi_b,hyst_b,inside_b,latency,max_latency
+// with the angles in 1/100 degree and the times in us.
+//
+// RB6 and RB7 are also the ICSP pins and the incremental encoder
+// input (quad-in.c), so the two cannot be used together.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "global_defs.h"
+#include "eeprom.h"
+#include "timestamp.h"
+#include "compare.h"
+
+static compare_window_t window[2];
+static uint32_t latency_us = 0;
+static uint32_t max_latency_us = 0;
+
+static uint16_t read_word(uint16_t addr)
+{
+    return (uint16_t)(DATAEE_ReadByte(addr+1) << 8) | DATAEE_ReadByte(addr);
+}
+
+static void write_byte(uint16_t addr, uint8_t b)
+{
+    // Only bytes that differ are written, as in config.c,
+    // to spare the EEPROM.
+    if (DATAEE_ReadByte(addr) != b) { DATAEE_WriteByte(addr, b); }
+}
+
+static void write_word(uint16_t addr, uint16_t w)
+{
+    write_byte(addr, (uint8_t)(w & 0xff));
+    write_byte(addr+1, (uint8_t)(w >> 8));
+}
+
+static void set_pin(uint8_t ch, uint8_t on)
+{
+    if (ch == 0) { LATBbits.LATB6 = on; } else { LATBbits.LATB7 = on; }
+}
+
+static void set_direction(uint8_t ch)
+{
+    // Enabled outputs drive their pins; the others are left as inputs.
+    if (ch == 0) { TRISBbits.TRISB6 = !window[0].enabled; }
+    else { TRISBbits.TRISB7 = !window[1].enabled; }
+}
+
+void compare_init(void)
+{
+    // With a freshly-programmed chip, the enable byte reads 0xff
+    // and the outputs are left off.
+    ANSELBbits.ANSELB6 = 0; LATBbits.LATB6 = 0;
+    ANSELBbits.ANSELB7 = 0; LATBbits.LATB7 = 0;
+    for (uint8_t ch=0; ch < 2; ++ch) {
+        uint16_t addr = EE_ADDR_COMPARE + ch * EE_COMPARE_LEN;
+        window[ch].enabled = (DATAEE_ReadByte(addr) == 1);
+        window[ch].lo = (int16_t)read_word(addr+1);
+        window[ch].hi = (int16_t)read_word(addr+3);
+        window[ch].hyst = read_word(addr+5);
+        window[ch].inside = 0;
+        set_direction(ch);
+    }
+    latency_us = 0;
+    max_latency_us = 0;
+}
+
+void compare_close(void)
+{
+    window[0].enabled = 0; set_direction(0);
+    window[1].enabled = 0; set_direction(1);
+}
+
+uint8_t compare_set(uint8_t ch, uint8_t enabled, int32_t lo, int32_t hi, int32_t hyst)
+// Returns 1, and leaves the window alone, if the channel or
+// the angles (1/100 degree) are out of range.
+{
+    uint16_t addr = EE_ADDR_COMPARE + ch * EE_COMPARE_LEN;
+    if (ch > 1) return 1;
+    if (enabled && (lo < -18000 || lo > 18000 || hi < -18000 || hi > 18000 ||
+                    hyst < 0 || hyst > 18000)) return 1;
+    window[ch].enabled = enabled;
+    window[ch].inside = 0;
+    set_pin(ch, 0);
+    write_byte(addr, enabled);
+    if (enabled) {
+        window[ch].lo = (int16_t)lo;
+        window[ch].hi = (int16_t)hi;
+        window[ch].hyst = (uint16_t)hyst;
+        write_word(addr+1, (uint16_t)window[ch].lo);
+        write_word(addr+3, (uint16_t)window[ch].hi);
+        write_word(addr+5, window[ch].hyst);
+    }
+    set_direction(ch);
+    max_latency_us = 0;
+    return 0;
+}
+
+static uint8_t is_inside(compare_window_t* w, int16_t v)
+{
+    // Measure around the circle from the low edge, so that
+    // a window that wraps through 180 degrees needs no special case.
+    int32_t lo = w->lo;
+    int32_t width = (int32_t)w->hi - lo;
+    int32_t d;
+    if (width < 0) { width += 36000; }
+    if (w->inside) {
+        lo -= w->hyst;
+        width += 2 * (int32_t)w->hyst;
+        if (width >= 36000) return 1;
+    }
+    d = (int32_t)v - lo;
+    while (d < 0) { d += 36000; }
+    while (d >= 36000) { d -= 36000; }
+    return d <= width;
+}
+
+void compare_update(int16_t a_cdeg, int16_t b_cdeg, uint32_t t_sample)
+{
+    if (window[0].enabled) {
+        window[0].inside = is_inside(&window[0], a_cdeg);
+        set_pin(0, window[0].inside);
+    }
+    if (window[1].enabled) {
+        window[1].inside = is_inside(&window[1], b_cdeg);
+        set_pin(1, window[1].inside);
+    }
+    latency_us = timestamp_now() - t_sample;
+    if (latency_us > max_latency_us) { max_latency_us = latency_us; }
+}
+
+void compare_report(void)
+{
+    printf("L,%u,%d,%d,%u,%u,%u,%d,%d,%u,%u,%lu,%lu\r\n",
+           window[0].enabled, window[0].lo, window[0].hi, window[0].hyst, window[0].inside,
+           window[1].enabled, window[1].lo, window[1].hi, window[1].hyst, window[1].inside,
+           latency_us, max_latency_us);
+}
@@ -0,0 +1,22 @@
+// compare.h
+// PJ, 2026-10-18
+
+#ifndef MY_COMPARE
+#define MY_COMPARE
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t enabled;
+    int16_t lo, hi; // window in 1/100 degree; lo > hi wraps through 180
+    uint16_t hyst; // 1/100 degree, added to each side once inside
+    uint8_t inside;
+} compare_window_t;
+
+void compare_init(void);
+void compare_close(void);
+uint8_t compare_set(uint8_t ch, uint8_t enabled, int32_t lo, int32_t hi, int32_t hyst);
+void compare_update(int16_t a_cdeg, int16_t b_cdeg, uint32_t t_sample);
+void compare_report(void);
+
+#endif
@@ -0,0 +1,125 @@
+// config.c
+// Settings kept in EEPROM, so that the board starts as it was left
+// rather than as the firmware was built.  The record is written only
+// on request (E1 command) and, with a freshly-programmed chip or after
+// E0, is absent and the built-in defaults and DIP switches apply.
+//
+// The DIP switches remain an override.  The record notes the switches
+// as they were when it was saved; at reset, a switch that has since
+// been moved sets its own setting, as before, and a switch left alone
+// lets the saved setting stand.  So a board can be set up from the host
+// and still be put right at the bench without a terminal.
+//
+// Record, at EE_ADDR_CONFIG:
+//   0  CONFIG_MAGIC
+//   1  switches when saved
+//   2  cycle count
+//   3  flags
+//   4  keyframe, low byte
+//   5  keyframe, high byte
+//   6  incremental encoder lines, low byte
+//   7  incremental encoder lines, high byte
+//   8  more flags
+//   9  check byte, the complement of the sum of bytes 0-8
+// The magic number changes with the layout, so that an older record
+// is ignored rather than misread.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "eeprom.h"
+#include "encoder-mixed.h"
+#include "config.h"
+
+#define CONFIG_MAGIC 0xc6
+#define FLAG_RTS_CTS 0x01
+#define FLAG_AS5600 0x02
+#define FLAG_AEAT_12BIT 0x04
+#define FLAG_LCD 0x08
+#define FLAG_LED_DISPLAY 0x10
+#define FLAG_DELTA_STREAM 0x20
+#define FLAG_AS36_A 0x40
+#define FLAG_AS36_B 0x80
+#define FLAG2_AS5600_PWM 0x01
+
+static uint8_t read_record(uint8_t* rec)
+// Returns 1 if a good record is in EEPROM.
+{
+    uint8_t sum = 0;
+    for (uint8_t i=0; i < EE_CONFIG_LEN; ++i) {
+        rec[i] = DATAEE_ReadByte(EE_ADDR_CONFIG + i);
+        if (i < EE_CONFIG_LEN-1) { sum += rec[i]; }
+    }
+    return (rec[0] == CONFIG_MAGIC) && (rec[EE_CONFIG_LEN-1] == (uint8_t)~sum);
+}
+
+uint8_t config_saved(void)
+{
+    uint8_t rec[EE_CONFIG_LEN];
+    return read_record(rec);
+}
+
+uint8_t config_load(config_t* c, uint8_t switches)
+// On entry, c holds the built-in defaults.
+// Returns 1 if the saved record was used.
+{
+    uint8_t rec[EE_CONFIG_LEN];
+    uint8_t have = read_record(rec);
+    uint8_t moved = 0x0f; // Without a record, all switches are taken.
+    if (have) {
+        c->cycle_count = rec[2];
+        if (c->cycle_count < 1 || c->cycle_count > CONFIG_MAX_COUNT) { c->cycle_count = CONFIG_FAST_COUNT; }
+        c->rts_cts = (rec[3] & FLAG_RTS_CTS) != 0;
+        c->as5600 = (rec[3] & FLAG_AS5600) != 0;
+        c->aeat_12bit = (rec[3] & FLAG_AEAT_12BIT) != 0;
+        c->lcd = (rec[3] & FLAG_LCD) != 0;
+        c->led_display = (rec[3] & FLAG_LED_DISPLAY) != 0;
+        c->delta_stream = (rec[3] & FLAG_DELTA_STREAM) != 0;
+        c->ssi_types = ((rec[3] & FLAG_AS36_A) ? SSI_A_AS36 : 0) | ((rec[3] & FLAG_AS36_B) ? SSI_B_AS36 : 0);
+        c->keyframe = (uint16_t)(rec[5] << 8) | rec[4];
+        if (c->keyframe < 1) { c->keyframe = 1; }
+        c->quad_in_lines = (uint16_t)(rec[7] << 8) | rec[6];
+        if (c->quad_in_lines > 16383) { c->quad_in_lines = 0; }
+        c->as5600_pwm = (rec[8] & FLAG2_AS5600_PWM) != 0;
+        moved = (switches ^ rec[1]) & 0x0f;
+    }
+    if (moved & CONFIG_SW0) {
+        c->cycle_count = (switches & CONFIG_SW0) ? CONFIG_FAST_COUNT : CONFIG_SLOW_COUNT;
+    }
+    if (moved & CONFIG_SW1) { c->rts_cts = (switches & CONFIG_SW1) != 0; }
+    if (moved & CONFIG_SW2) { c->as5600 = (switches & CONFIG_SW2) != 0; }
+    if (moved & CONFIG_SW3) { c->aeat_12bit = (switches & CONFIG_SW3) != 0; }
+    return have;
+}
+
+void config_save(const config_t* c, uint8_t switches)
+{
+    uint8_t rec[EE_CONFIG_LEN];
+    uint8_t sum = 0;
+    rec[0] = CONFIG_MAGIC;
+    rec[1] = switches & 0x0f;
+    rec[2] = c->cycle_count;
+    rec[3] = (c->rts_cts ? FLAG_RTS_CTS : 0) | (c->as5600 ? FLAG_AS5600 : 0) |
+        (c->aeat_12bit ? FLAG_AEAT_12BIT : 0) | (c->lcd ? FLAG_LCD : 0) |
+        (c->led_display ? FLAG_LED_DISPLAY : 0) | (c->delta_stream ? FLAG_DELTA_STREAM : 0) |
+        ((c->ssi_types & SSI_A_AS36) ? FLAG_AS36_A : 0) | ((c->ssi_types & SSI_B_AS36) ? FLAG_AS36_B : 0);
+    rec[4] = (uint8_t)(c->keyframe & 0xff);
+    rec[5] = (uint8_t)(c->keyframe >> 8);
+    rec[6] = (uint8_t)(c->quad_in_lines & 0xff);
+    rec[7] = (uint8_t)(c->quad_in_lines >> 8);
+    rec[8] = (c->as5600_pwm ? FLAG2_AS5600_PWM : 0);
+    for (uint8_t i=0; i < EE_CONFIG_LEN-1; ++i) { sum += rec[i]; }
+    rec[EE_CONFIG_LEN-1] = (uint8_t)~sum;
+    // Only bytes that differ are written, to spare the EEPROM.
+    for (uint8_t i=0; i < EE_CONFIG_LEN; ++i) {
+        if (DATAEE_ReadByte(EE_ADDR_CONFIG + i) != rec[i]) {
+            DATAEE_WriteByte(EE_ADDR_CONFIG + i, rec[i]);
+        }
+    }
+}
+
+void config_erase(void)
+{
+    DATAEE_WriteByte(EE_ADDR_CONFIG, 0xff);
+}
@@ -0,0 +1,40 @@
+// config.h
+// PJ, 2026-10-18
+
+#ifndef MY_CONFIG
+#define MY_CONFIG
+
+#include <stdint.h>
+
+// Settings that are kept in EEPROM, as the mains use them.
+typedef struct {
+    uint8_t cycle_count; // Timer2 periods of 8*2.064ms, 1 to 15
+    uint8_t rts_cts;
+    uint8_t as5600;
+    uint8_t aeat_12bit;
+    uint8_t ssi_types; // channels with a Lika AS36, as in encoder-mixed.h
+    uint8_t lcd;
+    uint8_t led_display;
+    uint8_t delta_stream;
+    uint16_t keyframe; // samples between delta-stream keyframes
+    uint16_t quad_in_lines; // incremental encoder as channel B, 0 for none
+    uint8_t as5600_pwm; // AS5600 angle from its PWM output
+} config_t;
+
+// DIP switches, as read at reset.
+#define CONFIG_SW0 0x01 // 50ms cycle, rather than 116ms
+#define CONFIG_SW1 0x02 // RTS/CTS
+#define CONFIG_SW2 0x04 // AS5600 on I2C
+#define CONFIG_SW3 0x08 // 12-bit AEAT
+
+#define CONFIG_FAST_COUNT 3 // 50ms
+#define CONFIG_SLOW_COUNT 7 // 116ms
+#define CONFIG_MAX_COUNT 15
+#define CONFIG_US_PER_COUNT 16512L // 8*2.064ms
+
+uint8_t config_load(config_t* c, uint8_t switches);
+void config_save(const config_t* c, uint8_t switches);
+void config_erase(void);
+uint8_t config_saved(void);
+
+#endif
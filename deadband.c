@@ -0,0 +1,46 @@
+// deadband.c
+// Decide whether a new sample is worth sending (or displaying).
+// A record is due when either channel has moved by more than its
+// deadband since the last record, or when the heartbeat interval
+// has passed without a record, so that the host knows we are alive.
+// PJ, 2026-10-18
+
+#include <stdint.h>
+#include "deadband.h"
+
+void deadband_init(deadband_t* d, uint8_t nbits_a, uint8_t nbits_b,
+                   uint16_t band_a, uint16_t band_b, uint16_t heartbeat)
+{
+    d->mask_a = (nbits_a >= 16) ? 0xffff : (uint16_t)((1u << nbits_a) - 1);
+    d->mask_b = (nbits_b >= 16) ? 0xffff : (uint16_t)((1u << nbits_b) - 1);
+    d->band_a = band_a;
+    d->band_b = band_b;
+    d->heartbeat = (heartbeat > 0) ? heartbeat : 1;
+    d->silent = 0;
+    d->primed = 0;
+}
+
+static uint16_t wrap_distance(uint16_t x, uint16_t y, uint16_t mask)
+{
+    // Smallest distance between two positions around the circle.
+    uint16_t d = (uint16_t)(x - y) & mask;
+    uint16_t e = (uint16_t)(y - x) & mask;
+    return (d < e) ? d : e;
+}
+
+uint8_t deadband_check(deadband_t* d, uint16_t a, uint16_t b)
+// Returns 1 if a record should be sent for this sample.
+{
+    d->silent++;
+    if (d->primed &&
+        d->silent < d->heartbeat &&
+        wrap_distance(a, d->last_a, d->mask_a) <= d->band_a &&
+        wrap_distance(b, d->last_b, d->mask_b) <= d->band_b) {
+        return 0;
+    }
+    d->last_a = a;
+    d->last_b = b;
+    d->silent = 0;
+    d->primed = 1;
+    return 1;
+}
@@ -0,0 +1,22 @@
+// deadband.h
+// PJ, 2026-10-18
+
+#ifndef MY_DEADBAND
+#define MY_DEADBAND
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t band_a, band_b; // Changes no larger than these are ignored (counts).
+    uint16_t mask_a, mask_b; // Encoder ranges, for wrap-around.
+    uint16_t heartbeat; // Longest run of samples without a record.
+    uint16_t last_a, last_b; // Values at the last record.
+    uint16_t silent; // Samples since the last record.
+    uint8_t primed;
+} deadband_t;
+
+void deadband_init(deadband_t* d, uint8_t nbits_a, uint8_t nbits_b,
+                   uint16_t band_a, uint16_t band_b, uint16_t heartbeat);
+uint8_t deadband_check(deadband_t* d, uint16_t a, uint16_t b);
+
+#endif
@@ -0,0 +1,145 @@
+// delta-stream.c
+// Compressed output of raw encoder values for slowly-moving shafts.
+//
+// Samples are coded as a byte stream:
+//   0xff nbits seqH seqL aH aL bH bL  keyframe with full raw values
+//   00aaabbb                          small change, a and b in -4..3
+//   01nnnnnn                          n+1 repeats of the previous sample
+//   0x80 <varint a> <varint b>        larger change
+// Changes are taken modulo the encoder range, so that they stay small
+// across the 0/4095 or 0/65535 boundary, and are sent as zig-zag
+// varints (7 bits per byte, least-significant group first, top bit set
+// on all but the last byte).
+//
+// The bytes are sent as lines of text, "Z" followed by the bytes coded
+// 3 to 4 into the characters '0' through 'o', so that the compressed
+// records can be interleaved with the other (text) records.
+// The first byte of each line is a line counter, so that a lost line
+// can be detected, and a keyframe always starts a new line.
+// No record is split across lines.
+// See host/delta-stream.cpp for the decoder.
+//
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "global_defs.h"
+#include "uart.h"
+#include "delta-stream.h"
+
+// Lines are at most 1+ZBUF_LEN*4/3 characters plus \r\n.
+#define ZBUF_LEN 48
+
+static uint8_t zbuf[ZBUF_LEN];
+static uint8_t nz = 0;
+static uint8_t line_count = 0;
+static uint8_t nbits = 12;
+static uint16_t mask = 0x0fff;
+static uint16_t interval = 20;
+static uint16_t since_key = 0;
+static uint16_t seq = 0;
+static uint16_t prev_a, prev_b;
+static uint8_t run = 0;
+static uint8_t need_key = 1;
+
+void delta_stream_init(uint8_t nbits_, uint16_t keyframe_interval)
+{
+    nbits = nbits_;
+    mask = (nbits >= 16) ? 0xffff : (uint16_t)((1u << nbits) - 1);
+    interval = (keyframe_interval > 0) ? keyframe_interval : 1;
+    nz = 0; run = 0;
+    since_key = 0; seq = 0;
+    need_key = 1;
+}
+
+static void send_line(void)
+{
+    uint8_t i, b0, b1, b2;
+    if (nz <= 1) return; // Nothing but the line counter.
+    putch('Z');
+    for (i=0; i < nz; i += 3) {
+        b0 = zbuf[i];
+        b1 = (i+1 < nz) ? zbuf[i+1] : 0;
+        b2 = (i+2 < nz) ? zbuf[i+2] : 0;
+        putch('0' + (b0 >> 2));
+        putch('0' + (((b0 & 0x03) << 4) | (b1 >> 4)));
+        if (i+1 < nz) putch('0' + (((b1 & 0x0f) << 2) | (b2 >> 6)));
+        if (i+2 < nz) putch('0' + (b2 & 0x3f));
+    }
+    putch('\r'); putch('\n');
+    nz = 0;
+}
+
+static void reserve(uint8_t n)
+{
+    // Make room for a record of n bytes, starting a new line if needed.
+    if (nz + n > ZBUF_LEN) { send_line(); }
+    if (nz == 0) { zbuf[nz++] = line_count++; }
+}
+
+static void put_varint(int16_t d)
+{
+    uint16_t z = (uint16_t)(d << 1) ^ (uint16_t)(d >> 15); // zig-zag
+    while (z >= 0x80) {
+        zbuf[nz++] = (uint8_t)(z & 0x7f) | 0x80;
+        z >>= 7;
+    }
+    zbuf[nz++] = (uint8_t)z;
+}
+
+static void flush_run(void)
+{
+    if (run == 0) return;
+    reserve(1);
+    zbuf[nz++] = 0x40 | (run - 1);
+    run = 0;
+}
+
+static int16_t wrap_delta(uint16_t x, uint16_t prev)
+{
+    uint16_t d = (uint16_t)(x - prev) & mask;
+    if (d & ((mask >> 1) + 1)) { d |= ~mask; } // sign-extend
+    return (int16_t)d;
+}
+
+void delta_stream_put(uint16_t a, uint16_t b)
+{
+    int16_t da = wrap_delta(a, prev_a);
+    int16_t db = wrap_delta(b, prev_b);
+    if (need_key || since_key >= interval) {
+        flush_run();
+        send_line();
+        reserve(8);
+        zbuf[nz++] = 0xff;
+        zbuf[nz++] = nbits;
+        zbuf[nz++] = (uint8_t)(seq >> 8); zbuf[nz++] = (uint8_t)seq;
+        zbuf[nz++] = (uint8_t)(a >> 8); zbuf[nz++] = (uint8_t)a;
+        zbuf[nz++] = (uint8_t)(b >> 8); zbuf[nz++] = (uint8_t)b;
+        since_key = 0;
+        need_key = 0;
+    } else if (da == 0 && db == 0) {
+        if (++run == 64) { flush_run(); }
+    } else {
+        flush_run();
+        if (da >= -4 && da <= 3 && db >= -4 && db <= 3) {
+            reserve(1);
+            zbuf[nz++] = (uint8_t)(((da & 0x07) << 3) | (db & 0x07));
+        } else {
+            reserve(7);
+            zbuf[nz++] = 0x80;
+            put_varint(da);
+            put_varint(db);
+        }
+    }
+    prev_a = a; prev_b = b;
+    seq++;
+    since_key++;
+}
+
+void delta_stream_flush(void)
+{
+    // Send whatever has been coded so far.
+    flush_run();
+    send_line();
+}
@@ -0,0 +1,13 @@
+// delta-stream.h
+// PJ, 2026-10-18
+
+#ifndef MY_DELTA_STREAM
+#define MY_DELTA_STREAM
+
+#include <stdint.h>
+
+void delta_stream_init(uint8_t nbits, uint16_t keyframe_interval);
+void delta_stream_put(uint16_t a, uint16_t b);
+void delta_stream_flush(void);
+
+#endif
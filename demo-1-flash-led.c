@@ -52,12 +52,13 @@
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 
 #define GREENLED LATBbits.LATB5
 
 int main()
 {
-    OSCFRQbits.HFFRQ = 0b0110; // Select 32MHz.
+    OSCFRQbits.HFFRQ = CLOCK_HFFRQ; // Select FOSC.
     TRISBbits.TRISB5 = 0; // Pin as output for LED.
     GREENLED = 0;
     while (1) {
@@ -54,6 +54,7 @@
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include "uart.h"
 #include <stdio.h>
 #include <string.h>
@@ -66,7 +67,7 @@ int main(void)
     char buf[80];
     char* buf_ptr;
     int n;
-    OSCFRQbits.HFFRQ = 0b0110; // Select 32MHz.
+    OSCFRQbits.HFFRQ = CLOCK_HFFRQ; // Select FOSC.
     TRISBbits.TRISB5 = 0; // Pin as output for LED.
     GREENLED = 0;
     uart1_init(115200);
@@ -52,13 +52,14 @@
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include "timer2-free-run.h"
 
 #define GREENLED LATBbits.LATB5
 
 int main()
 {
-    OSCFRQbits.HFFRQ = 0b0110; // Select 32MHz.
+    OSCFRQbits.HFFRQ = CLOCK_HFFRQ; // Select FOSC.
     TRISBbits.TRISB5 = 0; // Pin as output for LED.
     GREENLED = 0;
     timer2_init(61, 8); // 61 * 2.064ms * 8 = 1007ms period
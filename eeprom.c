@@ -3,9 +3,12 @@
 #include <xc.h>
 #include <stdint.h>
 
+static uint16_t write_count = 0; // PJ 2026-10-18 for the health counters
+
 void DATAEE_WriteByte(uint16_t bAdd, uint8_t bData)
 {
     uint8_t GIEBitValue = INTCONbits.GIE;
+    write_count++;
     
     //Set NVMADR with the target word address: 0x310000 - 0x3103FF
     NVMADRU = 0x31;
@@ -25,17 +28,23 @@ void DATAEE_WriteByte(uint16_t bAdd, uint8_t bData)
     NVMCON2 = 0x55;
     NVMCON2 = 0xAA;
 
-    //Start DATAEE write and wait for the operation to complete
+    //Start DATAEE write
     NVMCON1bits.WR = 1;
-    while (NVMCON1bits.WR);
 
     //Restore all the interrupts
+    //PJ 2026-10-18 Only the unlock sequence needs them held off, not
+    //the write itself (about 4ms), which would delay the trigger input.
     INTCONbits.GIE = GIEBitValue;
 
+    //Wait for the operation to complete
+    while (NVMCON1bits.WR);
+
     //Disable NVM access
     NVMCON0bits.NVMEN = 0;
 }
 
+uint16_t DATAEE_GetWriteCount(void) { return write_count; }
+
 uint8_t DATAEE_ReadByte(uint16_t bAdd)
 {
     //Set NVMADR with the target word address: 0x310000 - 0x3103FF
@@ -1,5 +1,6 @@
 // eeprom.h Code generated by MCC and then put here by PJ
 #ifndef EEPROM_H
+#define EEPROM_H
 /**
   @Summary
     Writes a data byte to EEPROM
@@ -52,4 +53,18 @@ void DATAEE_WriteByte(uint16_t bAdd, uint8_t bData);
     </code>
 */
 uint8_t DATAEE_ReadByte(uint16_t bAdd);
+
+// Number of bytes written since reset.
+uint16_t DATAEE_GetWriteCount(void);
+
+// Allocation of EEPROM bytes in the readout firmware.
+#define EE_ADDR_A_REF 0 // 2 bytes, low byte first
+#define EE_ADDR_B_REF 2
+#define EE_ADDR_WDT_RESETS 4 // 2 bytes, stats.c
+#define EE_ADDR_COMPARE 6 // compare.c, for channels A and B:
+#define EE_COMPARE_LEN 7 // enable, lo, hi, hysteresis
+#define EE_ADDR_CALIB_ENABLE 20 // calib.c, 1 byte per channel
+#define EE_ADDR_CALIB_TABLE 22 // 2 channels of CALIB_POINTS, 2 bytes each
+#define EE_ADDR_CONFIG 278 // config.c, after the calibration tables
+#define EE_CONFIG_LEN 10
 #endif
@@ -0,0 +1,69 @@
+// encoder-mixed.c
+// Read an AEAT-901x on one channel and a Lika AS36 on the other,
+// sharing CLK, in one frame rather than one after the other.
+//
+// The AEAT is framed by CSn and presents each bit after a rising edge
+// of CLK; the AS36 ignores CSn, latches its position on the first
+// falling edge and presents each bit after a rising edge, to be read
+// after the following falling edge.  So one sequence serves both:
+//   CSn low, CLK falls (AS36 latches)
+//   then, for each bit k:
+//     CLK rises, read AEAT bit k;  CLK falls, read AS36 bit k
+// with CSn raised, as in read_AEAT_encoders(), once the AEAT's last bit
+// is in, while the clock is high.  The AEAT ignores the rest of the clock.
+// The frame takes as long as the AS36 alone, where reading the two in
+// turn would add the whole AEAT frame.
+//
+// With both channels the same, the usual readers are used.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "encoder.h"
+#include "lika-as36.h"
+#include "encoder-mixed.h"
+
+#define CSn LATAbits.LATA4
+#define CLK LATAbits.LATA5
+#define DI_A PORTAbits.RA6
+#define DI_B PORTAbits.RA7
+
+void read_mixed_encoders(uint16_t *result_a, uint16_t *result_b, uint8_t types, uint8_t aeat_nbits)
+{
+    uint8_t i;
+    uint16_t bits_a, bits_b;
+    uint8_t a_as36 = (types & SSI_A_AS36) != 0;
+    if (types == 0) {
+        read_AEAT_encoders(result_a, result_b, aeat_nbits);
+        return;
+    }
+    if (types == (SSI_A_AS36 | SSI_B_AS36)) {
+        read_AS36_encoders(result_a, result_b);
+        return;
+    }
+    // Presuming CLK = 1; CSn = 1; at the start.
+    bits_a = 0;
+    bits_b = 0;
+    CSn = 0; // select the AEAT
+    __delay_us(1);
+    CLK = 0; // The AS36 stores its position.
+    __delay_us(1);
+    for (i=0; i < AS36_NBITS; i++) {
+        CLK = 1;
+        __delay_us(1);
+        if (i < aeat_nbits) {
+            // The AEAT's next bit.
+            if (a_as36) { bits_b = (bits_b << 1) | DI_B; } else { bits_a = (bits_a << 1) | DI_A; }
+            if (i == aeat_nbits - 1) { CSn = 1; } // deselect the AEAT
+        }
+        CLK = 0;
+        // The AS36's next bit.
+        if (a_as36) { bits_a = (bits_a << 1) | DI_A; } else { bits_b = (bits_b << 1) | DI_B; }
+        __delay_us(1);
+    }
+    __delay_us(1);
+    CLK = 1; // Finally, put clock high and allow the AS36 to time-out
+    __delay_us(16);
+    *result_a = bits_a; *result_b = bits_b;
+}
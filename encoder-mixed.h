@@ -0,0 +1,17 @@
+// encoder-mixed.h
+// PJ, 2026-10-18
+
+#ifndef MIXED_ENCODER_H
+#define MIXED_ENCODER_H
+
+#include <stdint.h>
+
+// Which channels carry a Lika AS36, rather than an AEAT-901x.
+#define SSI_A_AS36 0x01
+#define SSI_B_AS36 0x02
+
+#define AS36_NBITS 16
+
+void read_mixed_encoders(uint16_t *result_a, uint16_t *result_b, uint8_t types, uint8_t aeat_nbits);
+
+#endif
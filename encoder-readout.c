@@ -17,9 +17,33 @@
 //               to the range of the specific encoder.
 // PJ 2025-02-03 Andy's request to put \n at end of UART messages.
 //               Switch to allow higher frequency reporting.
+// PJ 2026-10-18 External trigger input on RC0 latches both encoders.
+//               Burst capture to RAM, commands from the host.
+//               Compressed (delta and run-length) output format.
+//               Deadband and heartbeat for UART records and LED display.
+//               Baud rates up to 2Mbaud, checked; optional auto-baud.
+//               FOSC of 32MHz or 64MHz, selected at build time.
+//               Wait in Idle mode for the end of the cycle; report slack time.
+//               Health counters, reported on request, in place of
+//               the i2c error messages in the data stream.
+//               Time-sync exchange with the host (Y command).
+//               AS5600 read just before the SSI latch, with its time
+//               noted, and optionally moved onto the SSI latch instant.
+//               AS5600 magnet status checked with each angle.
+//               AS5600 angle optionally measured from its PWM output.
+//               I2C bus recovery, and back-off from a dead LCD or AS5600.
+//               Quadrature (A/B/Z) output from either channel (I command).
+//               Incremental encoder input, counted by CLC and timers, as channel B.
+//               Position-compare outputs with windows kept in EEPROM (L command).
+//               Analog (PWM) output of either channel on RB2 (V command).
+//               Per-channel nonlinearity correction tables in EEPROM (N command).
+//               Wrap-aware low-pass filter of each raw reading (F command).
+//               Windowed min/max/mean/sd summaries in place of samples (G command).
+//               Settings kept in EEPROM and changed while running (O, E commands).
+//               Either channel may be a Lika AS36, read in the same SSI frame.
 //
 // This version string will be printed shortly after MCU reset.
-#define VERSION_STR "v3.3 2025-02-03"
+#define VERSION_STR "v3.25 2026-10-18"
 //
 // Configuration Bit Settings (generated from Config Memory View)
 // CONFIG1L
@@ -71,15 +95,35 @@
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "eeprom.h"
 #include "uart.h"
 #include "timer2-free-run.h"
 #include "encoder.h"
+#include "encoder-mixed.h"
 #include "i2c.h"
+#include "as5600.h"
+#include "as5600-pwm.h"
 #include "spi-max7219.h"
+#include "timestamp.h"
+#include "trigger.h"
+#include "command.h"
+#include "capture.h"
+#include "delta-stream.h"
+#include "deadband.h"
+#include "stats.h"
+#include "quad-out.h"
+#include "quad-in.h"
+#include "compare.h"
+#include "analog-out.h"
+#include "calib.h"
+#include "filter.h"
+#include "summary.h"
+#include "config.h"
 
 #define GREENLED LATBbits.LATB5
 #define SW0 PORTAbits.RA0
@@ -93,7 +137,58 @@
 #define NCBUF 20
 static char char_buffer[NCBUF];
 #define ADDR_LCD 0x51
-#define ADDR_AS5600 0x36
+
+// Configuration that is also needed by the interrupt service routine.
+static uint8_t use_i2c_AS5600 = 0;
+static uint8_t aeat_nbits = 12;
+static uint8_t ssi_types = 0; // channels with a Lika AS36 in place of an AEAT
+static volatile uint16_t a_raw_AS5600 = 0; // most recent AS5600 value
+static uint8_t use_quad_in = 0; // Incremental encoder on RB6/RB7 in place of channel B (O7).
+
+// Things needed for the external trigger input.
+// The interrupt service routine latches the encoders when a trigger edge
+// arrives, so the main loop must hold off interrupts while it is
+// clocking the SSI lines itself.
+void __interrupt() isr(void)
+{
+    uint16_t a, b;
+    uint32_t t_latch;
+    int32_t count = 0;
+    timestamp_service_irq();
+    timer2_service_irq();
+    uart1_service_irq();
+    quad_out_service_irq();
+    quad_in_service_irq();
+    as5600_pwm_service_irq();
+    if (trigger_edge_pending()) {
+        t_latch = timestamp_now();
+        if (use_quad_in) { count = quad_in_count_now(); }
+        read_mixed_encoders(&a, &b, ssi_types, aeat_nbits);
+        // The AS5600 cannot be read from here without disturbing
+        // the main loop's I2C transactions, so we report its latest value.
+        if (use_i2c_AS5600) { a = a_raw_AS5600; }
+        // The incremental count, taken with the frame, is scaled
+        // only now so as not to delay the latch.
+        if (use_quad_in) { b = quad_in_count_position(count, (ssi_types & SSI_B_AS36) ? AS36_NBITS : aeat_nbits); }
+        trigger_push(a, b, t_latch);
+    }
+}
+
+// Trigger records that arrive while we wait for the next cycle are
+// sent from the wait, rather than a cycle later, so long as each line
+// is out before t_send_by, a line's time ahead of the next sample.
+static uint32_t t_send_by = 0;
+
+static void send_trigger_records(void)
+{
+    // The idle task for timer2_wait().
+    int n;
+    trigger_record_t rec;
+    while ((int32_t)(t_send_by - timestamp_now()) > 0 && trigger_pop(&rec)) {
+        n = printf("T,%u,%lu,%u,%4u,%4u\r\n", rec.seq, rec.t_edge,
+                   rec.latency, rec.a, rec.b);
+    }
+}
 
 void display_to_lcd_unsigned(uint16_t a, uint16_t b)
 {
@@ -102,6 +197,9 @@ void display_to_lcd_unsigned(uint16_t a, uint16_t b)
     // Set cursor to DDRAM address 0
     char_buffer[0] = 0xfe; char_buffer[1] = 0x45; char_buffer[2] = 0x00;
     n = i2c1_write(ADDR_LCD, 3, (uint8_t*)char_buffer);
+    // If the LCD is not answering, or is being backed off from,
+    // don't spend the rest of the cycle writing to it.
+    if (i2c1_get_error_flag()) return;
     __delay_ms(3); // Give the LCD time
     n = sprintf(char_buffer, "A:%4u B:%4u    ", a, b);
     for (uint8_t i=0; i < NCBUF; ++i) {
@@ -141,6 +239,13 @@ void values_to_string_buffer(int16_t a, int16_t b, char* chrs)
     }
 }
 
+uint8_t read_switches(void)
+{
+    // The DIP switches as config.c wants them.
+    return (SW0 ? CONFIG_SW0 : 0) | (SW1 ? CONFIG_SW1 : 0) |
+        (SW2 ? CONFIG_SW2 : 0) | (SW3 ? CONFIG_SW3 : 0);
+}
+
 int main(void)
 {
     int n;
@@ -150,6 +255,22 @@ int main(void)
     int32_t a_signed, b_signed; // 32-bit to store angles in 1/100 degree resolution.
     int32_t big; // working variable for scaling to degrees
     char digits_buffer[16]; // string of characters to display signed values
+    char cmd_buffer[COMMAND_LEN]; // command line from the host
+    long args[4]; // numbers that follow the command letter
+    uint8_t nargs;
+    long baud_actual;
+    int16_t baud_err;
+    deadband_t uart_gate, display_gate;
+    uint16_t sample_seq = 0; // counts every sample
+    uint16_t record_seq = 0; // counts records sent when using the deadband
+    uint32_t t_sample = 0; // when the latest sample was taken (SSI latch)
+    uint16_t a_AS5600 = 0, a_prev_AS5600 = 0; // latest two AS5600 angles
+    uint32_t t_a = 0, t_a_prev = 0; // and when they were taken
+    uint32_t t_reply; // when we answer a time-sync request
+    uint32_t t_wait; // start of slack time
+    uint32_t slack_us = 0; // slack time in the most recent cycle
+    uint32_t min_slack_us = 0xffffffff; // and the least seen
+    uint32_t cycle_us; // nominal period of the main loop
     //
     uint8_t lcd_count_display = 0;
     uint8_t lcd_count_clear = 0;
@@ -157,14 +278,39 @@ int main(void)
     //
     // Default/expected configuration.
     uint8_t use_uart = 1;
+    long uart_baud = UART1_DEFAULT_BAUD; // Up to 1000000 or 2000000 as the host allows.
+    uint8_t use_autobaud = 0; // Look for the host's 'U' just after reset.
     uint8_t with_rts_cts = 1;
     uint8_t use_i2c_lcd = 0;
-    uint8_t use_i2c_AS5600 = 0;
+    uint8_t use_AS5600_pwm = 0; // Measure the AS5600 angle from its PWM output on RB2 (O8).
     uint8_t assume_AEAT_12bit = 1;
+    uint8_t a_nbits, b_nbits;
+    uint8_t ssi_nbits; // the wider of the two SSI channels
+    uint8_t next_ssi_types; // from the O command, for the next reset
     uint8_t use_spi_led_display = 1;
-    uint8_t fast_cycle = 1;
+    uint8_t cycle_count = CONFIG_FAST_COUNT; // Timer2 periods of 16.5ms
+    uint8_t new_cycle_count; // from the O command, for the next cycle
+    config_t cfg; // settings saved in EEPROM, for the E command
+    uint8_t have_config;
+    uint8_t next_AS5600; // from the O command, for the next reset
+    uint8_t next_AS5600_pwm; // from the O command, for the next reset
+    uint8_t use_trigger = 1;
+    uint8_t use_delta_stream = 0; // Selected by command from the host.
+    uint16_t delta_keyframe = 20;
+    uint8_t use_deadband = 0; // Selected by command from the host.
+    uint16_t quad_lines = 0; // Selected by command from the host; 0 for off.
+    uint16_t summary_s = 0; // G window in seconds; 0 for off
+    uint16_t quad_in_lines = 0; // of the incremental encoder on RB6/RB7; 0 for none
+    uint16_t next_quad_in_lines; // from the O command, for the next reset
+    uint8_t quad_channel = 1; // 0 for A, 1 for B
+    uint8_t use_analog_out = 0; // Selected by command from the host.
+    uint8_t analog_channel = 1; // 0 for A, 1 for B
+    int16_t analog_zero = 0; // 1/100 degree at mid-scale
+    uint16_t analog_span = 36000; // 1/100 degree over the full scale
+    uint8_t use_skew_interp = 0; // Selected by command from the host.
+    uint8_t wait_mode = TIMER2_WAIT_IDLE; // Save power in the slack time.
     //
-    OSCFRQbits.HFFRQ = 0b0110; // Select 32MHz.
+    clock_init(); // Select FOSC, as set in global_defs.h.
     TRISBbits.TRISB5 = 0; // Pin as output for LED.
     GREENLED = 0;
     TRISBbits.TRISB4 = 1; ANSELBbits.ANSELB4 = 0; WPUBbits.WPUB4 = 1; // PUSHBUTTONA
@@ -175,42 +321,78 @@ int main(void)
     TRISAbits.TRISA1 = 1; ANSELAbits.ANSELA1 = 0; WPUAbits.WPUA1 = 1; // Input SW1
     TRISAbits.TRISA2 = 1; ANSELAbits.ANSELA2 = 0; WPUAbits.WPUA2 = 1; // Input SW2
     TRISAbits.TRISA3 = 1; ANSELAbits.ANSELA3 = 0; WPUAbits.WPUA3 = 1; // Input SW3
-    if (SW0) { fast_cycle = 1; } else { fast_cycle = 0; }
-    if (SW1) { with_rts_cts = 1; } else { with_rts_cts = 0; }
-    if (SW2) { use_i2c_AS5600 = 1; } else { use_i2c_AS5600 = 0; }
-    if (SW3) { assume_AEAT_12bit = 1; } else { assume_AEAT_12bit = 0; }
-    uint8_t aeat_nbits = (assume_AEAT_12bit) ? 12 : 10;
+    // Settings saved from the host stand, unless a switch has been
+    // moved since they were saved (config.c).
+    cfg.cycle_count = cycle_count; cfg.rts_cts = with_rts_cts;
+    cfg.as5600 = use_i2c_AS5600; cfg.aeat_12bit = assume_AEAT_12bit;
+    cfg.ssi_types = ssi_types;
+    cfg.lcd = use_i2c_lcd; cfg.led_display = use_spi_led_display;
+    cfg.delta_stream = use_delta_stream; cfg.keyframe = delta_keyframe;
+    cfg.quad_in_lines = quad_in_lines; cfg.as5600_pwm = use_AS5600_pwm;
+    have_config = config_load(&cfg, read_switches());
+    cycle_count = cfg.cycle_count; with_rts_cts = cfg.rts_cts;
+    use_i2c_AS5600 = cfg.as5600; assume_AEAT_12bit = cfg.aeat_12bit;
+    ssi_types = cfg.ssi_types;
+    use_i2c_lcd = cfg.lcd; use_spi_led_display = cfg.led_display;
+    use_delta_stream = cfg.delta_stream; delta_keyframe = cfg.keyframe;
+    quad_in_lines = cfg.quad_in_lines;
+    use_quad_in = (quad_in_lines != 0);
+    use_AS5600_pwm = cfg.as5600_pwm;
+    next_AS5600_pwm = use_AS5600_pwm;
+    next_quad_in_lines = quad_in_lines;
+    next_AS5600 = use_i2c_AS5600;
+    next_ssi_types = ssi_types;
+    // Each SSI channel has an AEAT-901x (10 or 12 bits, as SW3 says)
+    // or a Lika AS36 (16 bits), read together (encoder-mixed.c).
+    aeat_nbits = (assume_AEAT_12bit) ? 12 : 10;
+    a_nbits = (use_i2c_AS5600) ? 12 : (ssi_types & SSI_A_AS36) ? AS36_NBITS : aeat_nbits;
+    b_nbits = (ssi_types & SSI_B_AS36) ? AS36_NBITS : aeat_nbits;
+    ssi_nbits = (ssi_types) ? AS36_NBITS : aeat_nbits;
+    filter_init(0, a_nbits);
+    filter_init(1, b_nbits);
+    uint16_t a_mask = (uint16_t)((1UL << a_nbits) - 1);
+    uint16_t b_mask = (uint16_t)((1UL << b_nbits) - 1);
+    //
+    stats_init(); // Also notes a watchdog reset in EEPROM.
+    calib_init();
     //
     // Get ref values out of EEPROM.
     // With a freshly-programmed chip, all of the bits read from the EEPROM
     // will be 1, and the resulting reference value will be 0xffff and
-    // out of range for a 10-bit or 12-bit encoder.
+    // out of range for a 10-bit or 12-bit encoder (but not for the AS36).
     a_ref = (uint16_t) (DATAEE_ReadByte(1) << 8) | DATAEE_ReadByte(0);
     b_ref = (uint16_t) (DATAEE_ReadByte(3) << 8) | DATAEE_ReadByte(2);
-    if (use_i2c_AS5600 || assume_AEAT_12bit) {
-        a_ref &= 0x0fff;
-    } else {
-        a_ref &= 0x03ff;
-    }
-    if (assume_AEAT_12bit) {
-        b_ref &= 0x0fff;
-    } else {
-        b_ref &= 0x03ff;
-    }
+    a_ref &= a_mask;
+    b_ref &= b_mask;
     //
     // Initialize the peripherals that are in play.
     init_AEAT_encoders();
     if (use_uart) {
-        uart1_init(115200);
+        if (uart1_init(uart_baud)) {
+            // The clock cannot make the requested rate closely enough.
+            uart1_init(UART1_DEFAULT_BAUD);
+        }
+        uart1_set_flow_control(with_rts_cts);
         __delay_ms(50); // Need a bit of delay to not miss the first characters.
         uart1_flush_rx();
+        if (use_autobaud) {
+            // The host may send a 'U' within 2 seconds of reset
+            // to set our baud rate to its own.
+            uart1_autobaud(2000);
+        }
         n = printf("Readout for AEAT-901x and AS5600 magnetic angle encoders.\r\n");
         n = printf("%s\r\n", VERSION_STR);
+        n = printf("FOSC %ld Hz.\r\n", FOSC);
+        if (have_config) {
+            n = printf("Settings from EEPROM, with any switches moved since.\r\n");
+        }
         if (with_rts_cts) {
             n = printf("Using RTS/CTS.\r\n");
         } else {
             n = printf("NOT using RTS/CTS.\r\n");
         }
+        n = printf("Baud rate %ld, error %d/10000.\r\n",
+                   uart1_get_actual_baud(), uart1_get_baud_error());
         if (use_i2c_AS5600) {
             n = printf("Using the AS5600 encoder on I2C.\r\n");
         } else {
@@ -221,39 +403,119 @@ int main(void)
         } else { 
             n = printf("Assuming 10-bit AEAT-9010 encoders.\r\n");
         }
+        if (ssi_types & SSI_A_AS36) { n = printf("Lika AS36 on channel A.\r\n"); }
+        if (ssi_types & SSI_B_AS36) { n = printf("Lika AS36 on channel B.\r\n"); }
         n = printf("a_ref: %4u  b_ref: %4u\r\n", a_ref, b_ref);
     }
     if (use_i2c_lcd || use_i2c_AS5600) {
         i2c1_init();
         __delay_ms(50); // Let the LCD get itself sorted at power-up.
+        if (use_i2c_AS5600) { as5600_init(); }
+        if (use_i2c_AS5600 && use_AS5600_pwm &&
+            (use_spi_led_display || as5600_select_pwm_output())) {
+            // The LED display has RB2 or the AS5600 has no PWM output,
+            // so we carry on reading over I2C.
+            use_AS5600_pwm = 0;
+        }
+        if (use_i2c_AS5600 && use_uart) {
+            if (use_AS5600_pwm) {
+                n = printf("AS5600 angle from PWM output on RB2.\r\n");
+            } else {
+                n = printf("AS5600 angle read over I2C.\r\n");
+            }
+        }
     }
     if (use_spi_led_display) {
         spi2_init();
         max7219_init();
     }
-    if (fast_cycle) {
-        timer2_init(3, 8); // 3 * 2.064ms * 8 = 50ms period
-        n = printf("Cycle period is 50ms.\r\n");
+    // 3 * 2.064ms * 8 = 50ms period, 7 * 2.064ms * 8 = 116ms period
+    timer2_init(cycle_count, 8);
+    cycle_us = cycle_count * CONFIG_US_PER_COUNT;
+    new_cycle_count = cycle_count;
+    n = printf("Cycle period is %lu us.\r\n", cycle_us);
+    if (use_delta_stream) { delta_stream_init((a_nbits > b_nbits) ? a_nbits : b_nbits, delta_keyframe); }
+    timestamp_init();
+    if (use_trigger) {
+        trigger_init();
+        n = printf("Trigger input on RC0.\r\n");
+    }
+    if (use_quad_in) {
+        quad_in_init(quad_in_lines);
+        n = printf("Incremental encoder, %u lines, on RB6/RB7 as channel B.\r\n", quad_in_lines);
     } else {
-        timer2_init(7, 8); // 7 * 2.064ms * 8 = 116ms period
-        n = printf("Cycle period is 116ms.\r\n");
+        // The compare outputs share RB6/RB7 with the incremental input.
+        compare_init();
     }
+    if (use_i2c_AS5600 && use_AS5600_pwm) { as5600_pwm_init(); }
+    if (use_uart) { uart1_enable_rx_interrupt(); }
+    timer2_set_wait_mode(wait_mode);
+    if (use_trigger && use_uart) { timer2_set_idle_task(send_trigger_records); }
+    INTCONbits.PEIE = 1;
+    ei();
     //
     timer2_wait();
     while (1) {
+        // 0. A burst capture, if armed, takes samples as fast as
+        //    the SSI encoders can be read and then we carry on as usual.
+        //    Only the SSI lines are sampled, even when the AS5600 is in use.
+        //    Interrupts are held off for each frame, as in step 1, and
+        //    are served in between.
+        if (capture_is_armed()) {
+            do {
+                CLRWDT();
+                di();
+                read_mixed_encoders(&a_raw, &b_raw, ssi_types, aeat_nbits);
+                ei();
+            } while (capture_store(a_raw, b_raw));
+        }
         // 1. Read the raw values from the sensors.
-        read_AEAT_encoders(&a_raw, &b_raw, aeat_nbits);
+        //    The AS5600 is read first, so that the SSI latch follows
+        //    its angle as closely as it can (a few hundred microseconds).
+        if (use_i2c_AS5600) {
+            a_prev_AS5600 = a_AS5600;
+            t_a_prev = t_a;
+            if (use_AS5600_pwm) {
+                // A frame completes every 8.7ms, so there should always
+                // be a new one; if not, the previous angle is used again.
+                if (!as5600_pwm_read(&a_AS5600, &t_a)) { stats_count(STATS_AS5600_PWM); }
+            } else {
+                // We should not be seeing errors but, if we do,
+                // they are counted for the S command and the previous
+                // angle is used again.
+                stats_count_i2c_error(as5600_read_raw_angle(&a_AS5600, &t_a));
+                if (!as5600_magnet_ok()) { stats_count(STATS_MAGNET); }
+            }
+        }
+        di(); // The trigger interrupt also clocks the SSI lines.
+        t_sample = timestamp_now();
+        read_mixed_encoders(&a_raw, &b_raw, ssi_types, aeat_nbits);
+        if (use_quad_in) { quad_in_latch(); }
+        ei();
+        stats_count(STATS_SAMPLES);
+        // With the AS5600 in use, no SSI encoder is connected to DI-A,
+        // and with the incremental encoder, none to DI-B.
+        stats_check_ssi((use_i2c_AS5600) ? 0 : a_raw, (use_quad_in) ? 0 : b_raw,
+                        a_mask, b_mask);
+        if (use_quad_in) {
+            // Scaled to channel B's resolution, for the rest of the pipeline.
+            b_raw = quad_in_position(b_nbits);
+        }
         if (use_i2c_AS5600) {
-            // We are going to replace reading A with the AS5600 data.
-            char_buffer[0] = 0x0c; // RAW ANGLE register, high byte
-            n = i2c1_write(ADDR_AS5600, 1, (uint8_t*)char_buffer);
-            n = i2c1_read(ADDR_AS5600, 2, (uint8_t*)char_buffer);
-            uint8_t err = i2c1_get_error_flag();
-            // Note that moving \r\n to end of lines will mess with the
-            // following error message but we should not be seeing such errors anyway.
-            if (err && use_uart) { printf("  i2c err=%u", err); }
-            a_raw = ((uint16_t)(char_buffer[0] & 0x0f)<<8) | (uint16_t)char_buffer[1];
+            // We replace reading A with the AS5600 data, optionally
+            // extrapolated from the last two angles to the SSI latch.
+            if (use_skew_interp) {
+                a_raw = as5600_interpolate(a_prev_AS5600, t_a_prev, a_AS5600, t_a, t_sample);
+            } else {
+                a_raw = a_AS5600;
+            }
+            a_raw_AS5600 = a_raw;
+        } else {
+            t_a = t_sample; // Both SSI channels latch together.
         }
+        // Low-pass filter, if selected, on every sample (filter.c).
+        a_raw = filter_apply(0, a_raw);
+        b_raw = filter_apply(1, b_raw);
         // 2. If the push buttons are active (low), set the reference values.
         if (PUSHBUTTONA == 0) {
             a_ref = a_raw;
@@ -274,27 +536,53 @@ int main(void)
         // 3. Convert to units of 1/100 degree.
         //    12-bit sensor range is 4096. 36000/4096 == 1125/128
         //    10-bit sensor range is 1024. 36000/1024 == 1125/32
+        //    16-bit sensor range is 65536. 36000/65536 == 1125/2048
+        //    In each case, the divisor is 2^(nbits-5).
         big = a_signed * 1125;
-        int16_t aeat_divisor = (assume_AEAT_12bit)? 128 : 32;
-        if (use_i2c_AS5600) {
-            a_signed = big/128;
-        } else {
-            a_signed = big/aeat_divisor;
-        }
-        // AEAT sensor range is 1024.
+        a_signed = big/(int32_t)(1L << (a_nbits - 5));
         big = b_signed * 1125;
-        b_signed = big/aeat_divisor;
+        b_signed = big/(int32_t)(1L << (b_nbits - 5));
+        // Nonlinearity correction, at the reading less that at the
+        // reference; nothing is added for a channel without a table.
+        a_signed += calib_correction(0, a_raw, a_nbits) - calib_correction(0, a_ref, a_nbits);
+        b_signed += calib_correction(1, b_raw, b_nbits) - calib_correction(1, b_ref, b_nbits);
         // 4. Bring into -180 to 180 degree range by wrapping around.
         if (a_signed < -18000) a_signed += 36000;
         if (a_signed > 18000) a_signed -= 36000;
         if (b_signed < -18000) b_signed += 36000;
         if (b_signed > 18000) b_signed -= 36000;
+        // The position-compare outputs go first, to keep their latency short.
+        if (!use_quad_in) { compare_update((int16_t)a_signed, (int16_t)b_signed, t_sample); }
+        if (use_analog_out) { analog_out_update((int16_t)a_signed, (int16_t)b_signed); }
         //
         // 5. Some output.
-        if (use_uart) {
-            uart1_flush_rx();
-            values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
-            n = printf("%4u,%4u,%s\r\n", a_raw, b_raw, digits_buffer);
+        //    With the deadband in use, records carry the sample number
+        //    and the record number, so that the host can tell
+        //    suppressed samples from lost records.
+        //    While summaries are selected, they take the place of
+        //    the per-sample records, so as to keep the link quiet.
+        sample_seq++;
+        if (summary_add((int16_t)a_signed, (int16_t)b_signed)) { summary_report(); }
+        if (use_uart && summary_get_interval() == 0) {
+            if (use_delta_stream) {
+                delta_stream_put(a_raw, b_raw);
+            } else if (!use_deadband) {
+                values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
+                n = printf("%4u,%4u,%s\r\n", a_raw, b_raw, digits_buffer);
+            } else if (deadband_check(&uart_gate, a_raw, b_raw)) {
+                values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
+                n = printf("%4u,%4u,%s,%u,%u\r\n", a_raw, b_raw, digits_buffer,
+                           sample_seq, record_seq++);
+            }
+        }
+        if (use_trigger) {
+            trigger_record_t rec;
+            while (trigger_pop(&rec)) {
+                if (use_uart) {
+                    n = printf("T,%u,%lu,%u,%4u,%4u\r\n", rec.seq, rec.t_edge,
+                               rec.latency, rec.a, rec.b);
+                }
+            }
         }
         if (use_i2c_lcd) {
             if (lcd_count_clear == 0) {
@@ -319,27 +607,410 @@ int main(void)
             } else {
                 lcd_count_display--;
             }
-            uint8_t err = i2c1_get_error_flag();
-            if (err && use_uart) { printf("  i2c err=%u", err); }
+            stats_count_i2c_error(i2c1_get_error_flag());
         }
         if (use_spi_led_display) {
             if (led_count_display == 0) {
-                // spi2_led_display_unsigned(a_raw, b_raw);
-                // Display integral degrees only to 7-segment LED display.
-                spi2_led_display_signed((int16_t)a_signed/100, (int16_t)b_signed/100);
-                led_count_display = 0; // every pass for Jeremy
+                // A redraw held back by the deadband leaves the count at 0.
+                if (!use_deadband || deadband_check(&display_gate, a_raw, b_raw)) {
+                    // spi2_led_display_unsigned(a_raw, b_raw);
+                    // Display integral degrees only to 7-segment LED display.
+                    spi2_led_display_signed((int16_t)a_signed/100, (int16_t)b_signed/100);
+                    led_count_display = 0; // every pass for Jeremy
+                }
             } else {
                 led_count_display--;
             }
         }
+        if (quad_lines) {
+            // The index pulse marks the reference position.
+            quad_out_update((quad_channel) ? b_raw - b_ref : a_raw - a_ref);
+        }
+        // 6. Commands from the host.
+        if (use_uart && command_poll(cmd_buffer)) {
+            switch (cmd_buffer[0]) {
+            case 'C':
+                // Arm a burst capture: C starts immediately,
+                // CT waits for an edge on the trigger input.
+                if (cmd_buffer[1] == 'T' && !use_trigger) {
+                    n = printf("C,no-trigger\r\n");
+                    break;
+                }
+                capture_arm(ssi_nbits, (cmd_buffer[1] == 'T'));
+                n = printf("C,armed\r\n");
+                break;
+            case 'D':
+                // Dump the burst capture, a line at a time.
+                if (!capture_dump_start()) { n = printf("D,none\r\n"); }
+                break;
+            case 'M':
+                // Output format: M0 for text lines,
+                // M1[,k] for compressed with a keyframe every k samples.
+                if (use_delta_stream) { delta_stream_flush(); }
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (nargs >= 1 && args[0] == 1) {
+                    if (nargs < 2) { args[1] = 20; }
+                    if (args[1] < 1) { args[1] = 1; }
+                    delta_keyframe = (uint16_t)args[1];
+                    delta_stream_init((a_nbits > b_nbits) ? a_nbits : b_nbits, (uint16_t)args[1]);
+                    use_delta_stream = 1;
+                } else {
+                    use_delta_stream = 0;
+                }
+                n = printf("M,%u\r\n", use_delta_stream);
+                break;
+            case 'Q':
+                // Deadband: Qa,b,h sends a record (and redraws the display)
+                // only when channel A or B has moved by more than a or b
+                // counts, or after h samples without a record.
+                // Q alone goes back to sending every sample.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs == 3) {
+                    deadband_init(&uart_gate, a_nbits, b_nbits, (uint16_t)args[0],
+                                  (uint16_t)args[1], (uint16_t)args[2]);
+                    display_gate = uart_gate;
+                    use_deadband = 1;
+                } else {
+                    use_deadband = 0;
+                }
+                n = printf("Q,%u\r\n", use_deadband);
+                break;
+            case 'B':
+                // Change baud rate: Bn replies at the old rate and then
+                // switches to n baud, if it can be made closely enough.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1 && uart1_check_baud(args[0], &baud_actual, &baud_err) == 0) {
+                    n = printf("B,%ld,%d\r\n", baud_actual, baud_err);
+                    uart1_wait_tx_done();
+                    uart1_set_baud(args[0]);
+                    uart_baud = args[0];
+                } else {
+                    n = printf("B,refused\r\n");
+                }
+                break;
+            case 'A':
+                // Auto-baud: after our reply, the host switches to
+                // its new rate and sends 'U' within 5 seconds.
+                n = printf("A,wait\r\n");
+                uart1_wait_tx_done();
+                if (uart1_autobaud(5000)) { uart_baud = uart1_get_actual_baud(); }
+                n = printf("A,%ld\r\n", uart1_get_actual_baud());
+                break;
+            case 'W':
+                // Wait mode: W reports the mode and the slack time (us)
+                // in the last cycle and the least seen.
+                // Wm selects 0 for spin, 1 for Idle, 2 for Doze
+                // and starts the least-slack measurement again.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) {
+                    timer2_set_wait_mode((uint8_t)args[0]);
+                    min_slack_us = 0xffffffff;
+                }
+                n = printf("W,%u,%lu,%lu\r\n", timer2_get_wait_mode(), slack_us, min_slack_us);
+                break;
+            case 'S':
+                // Health counters: S reports them, S0 clears them.
+                if (cmd_buffer[1] == '0') { stats_clear(); }
+                stats_report();
+                break;
+            case 'K':
+                // Skew between the channels: K reports when A and B were
+                // taken (us) in the latest sample and the difference;
+                // K1 moves the AS5600 angle onto the SSI latch instant, K0 stops.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) { use_skew_interp = (args[0] != 0); }
+                n = printf("K,%u,%lu,%lu,%ld\r\n", use_skew_interp, t_a, t_sample,
+                           (long)(t_sample - t_a));
+                break;
+            case 'H':
+                // AS5600 magnet health: H reports whether it is checked,
+                // the latest STATUS, AGC and MAGNITUDE, and 1 if the
+                // magnet is good; H0 stops checking, H1 resumes.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) { as5600_set_check_magnet(args[0] != 0); }
+                n = printf("H,%u,%u,%u,%u,%u\r\n", as5600_get_check_magnet(), as5600_get_status(),
+                           as5600_get_agc(), as5600_get_magnitude(), as5600_magnet_ok());
+                break;
+            case 'I':
+                // Quadrature output: Il[,c] gives l lines per turn
+                // from channel c (0 for A, 1 for B, the default);
+                // I0 stops it.  The pins are those of the LED display,
+                // and the counting hardware that of the incremental input.
+                // The most lines depends on the cycle (quad-out.c).
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (use_spi_led_display) {
+                    n = printf("I,no-pins\r\n");
+                    break;
+                }
+                if (use_quad_in) {
+                    n = printf("I,in-use\r\n");
+                    break;
+                }
+                if (nargs >= 1 && args[0] > (long)quad_out_max_lines(cycle_us)) {
+                    // Half a turn of steps would not fit in the cycle,
+                    // so the output could fall behind the shaft.
+                    n = printf("I,refused,%u\r\n", quad_out_max_lines(cycle_us));
+                    break;
+                }
+                if (nargs >= 1) {
+                    quad_lines = (args[0] > 0 && args[0] <= 16383) ? (uint16_t)args[0] : 0;
+                    quad_channel = (nargs < 2 || args[1] != 0);
+                    if (quad_lines) {
+                        quad_out_init(quad_lines, (quad_channel) ? b_nbits : a_nbits, cycle_us);
+                    } else {
+                        quad_out_close();
+                    }
+                }
+                n = printf("I,%u,%u,%u\r\n", quad_lines, quad_channel, quad_out_get_position());
+                break;
+            case 'L':
+                // Position-compare (limit switch) outputs: L reports them;
+                // Lc,lo,hi,h sets the window for channel c (0 for A, 1 for B)
+                // in 1/100 degree, with hysteresis h, and Lc turns it off.
+                // Settings are kept in EEPROM.
+                if (use_quad_in) {
+                    n = printf("L,no-pins\r\n");
+                    break;
+                }
+                nargs = command_parse_args(cmd_buffer, args, 4);
+                if (nargs >= 1 && (args[0] < 0 || args[0] > 1)) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                // Angles outside -18000 to 18000, or hysteresis over 18000,
+                // are refused rather than stored.
+                if (nargs == 4 && compare_set((uint8_t)args[0], 1, args[1], args[2], args[3])) {
+                    n = printf("L,refused\r\n");
+                    break;
+                } else if (nargs == 1) {
+                    compare_set((uint8_t)args[0], 0, 0, 0, 0);
+                }
+                compare_report();
+                break;
+            case 'V':
+                // Analog (PWM) output: V1[,c[,z,s]] gives channel c
+                // (0 for A, 1 for B) with z at mid-scale and s over
+                // the full scale, in 1/100 degree; V0 stops it.
+                // The pin is one of the LED display's, and is also
+                // the AS5600 PWM input.
+                nargs = command_parse_args(cmd_buffer, args, 4);
+                if (use_spi_led_display) {
+                    n = printf("V,no-pins\r\n");
+                    break;
+                }
+                if (use_i2c_AS5600 && use_AS5600_pwm) {
+                    n = printf("V,in-use\r\n");
+                    break;
+                }
+                if (nargs >= 1) {
+                    use_analog_out = (args[0] != 0);
+                    if (nargs >= 2) { analog_channel = (args[1] != 0); }
+                    if (nargs >= 4 && args[3] > 0 && args[3] <= 36000) {
+                        analog_zero = (int16_t)args[2];
+                        analog_span = (uint16_t)args[3];
+                    }
+                    if (use_analog_out) {
+                        analog_out_init(analog_channel, analog_zero, analog_span);
+                    } else {
+                        analog_out_close();
+                    }
+                }
+                n = printf("V,%u,%u,%d,%u,%u\r\n", use_analog_out, analog_channel,
+                           analog_zero, analog_span, analog_out_get_duty());
+                break;
+            case 'N':
+                // Nonlinearity correction: Nc reports channel c (0 for A,
+                // 1 for B); Nc,e turns its table on (1) or off (0) and
+                // Nc,i,v sets point i to v, in 1/100 degree.
+                // The tables, from host/calib-fit, are kept in EEPROM.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs < 1 || args[0] < 0 || args[0] > 1) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                if (nargs == 2) { calib_set_enabled((uint8_t)args[0], (args[1] != 0)); }
+                if (nargs == 3) {
+                    if (args[1] < 0 || args[1] >= CALIB_POINTS) {
+                        n = printf("?\r\n");
+                        break;
+                    }
+                    calib_set_point((uint8_t)args[0], (uint8_t)args[1], (int16_t)args[2]);
+                    n = printf("N,%u,%u,%u,%d\r\n", (uint8_t)args[0], calib_get_enabled((uint8_t)args[0]),
+                               (uint8_t)args[1], calib_get_point((uint8_t)args[0], (uint8_t)args[1]));
+                    break;
+                }
+                n = printf("N,%u,%u\r\n", (uint8_t)args[0], calib_get_enabled((uint8_t)args[0]));
+                break;
+            case 'F':
+                // Low-pass filter: Fc reports channel c (0 for A, 1 for B);
+                // Fc,o,k sets order o (0 for off, 1 or 2) with each stage
+                // taking 1/2^k of the step per sample.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs < 1 || args[0] < 0 || args[0] > 1) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                if (nargs == 3 && args[1] >= 0 && args[2] >= 0) {
+                    filter_set((uint8_t)args[0], (uint8_t)args[1], (uint8_t)args[2]);
+                }
+                n = printf("F,%u,%u,%u\r\n", (uint8_t)args[0], filter_get_order((uint8_t)args[0]),
+                           filter_get_shift((uint8_t)args[0]));
+                break;
+            case 'G':
+                // Summary statistics: Gs gives a G line every s seconds,
+                // in place of the per-sample records; G0 stops them.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1 && args[0] >= 0 && args[0] <= 2000) {
+                    summary_s = (uint16_t)args[0];
+                    summary_set_interval(summary_cycles(summary_s, cycle_us));
+                }
+                n = printf("G,%u\r\n", summary_get_interval());
+                break;
+            case 'O':
+                // Options, in effect from the next cycle:
+                //   O0,c  cycle of c periods of 16.5ms (1-15; 3 for 50ms)
+                //   O1,f  RTS/CTS flow control (0 or 1)
+                //   O2,b  AEAT resolution (10 or 12 bits)
+                //   O3,e  LCD (0 or 1)
+                //   O4,e  LED display (0 or 1)
+                //   O5,e  AS5600 on I2C (0 or 1), from the next reset
+                //   O6,m  Lika AS36 on channel A (m=1), B (m=2) or both (m=3)
+                //         in place of the AEAT, from the next reset
+                //   O7,l  incremental encoder of l lines on RB6/RB7 as channel B
+                //         (0 for none), from the next reset
+                //   O8,e  AS5600 angle from its PWM output on RB2 (0 or 1),
+                //         rather than over I2C, from the next reset
+                // O alone reports them; E1 keeps them in EEPROM.
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (nargs == 2 && args[0] == 0) {
+                    if (args[1] >= 1 && args[1] <= CONFIG_MAX_COUNT) { new_cycle_count = (uint8_t)args[1]; }
+                } else if (nargs == 2 && args[0] == 1) {
+                    with_rts_cts = (args[1] != 0);
+                    uart1_set_flow_control(with_rts_cts);
+                } else if (nargs == 2 && args[0] == 2 && (args[1] == 10 || args[1] == 12)) {
+                    assume_AEAT_12bit = (args[1] == 12);
+                    aeat_nbits = (uint8_t)args[1];
+                    a_nbits = (use_i2c_AS5600) ? 12 : (ssi_types & SSI_A_AS36) ? AS36_NBITS : aeat_nbits;
+                    b_nbits = (ssi_types & SSI_B_AS36) ? AS36_NBITS : aeat_nbits;
+                    ssi_nbits = (ssi_types) ? AS36_NBITS : aeat_nbits;
+                    a_mask = (uint16_t)((1UL << a_nbits) - 1);
+                    b_mask = (uint16_t)((1UL << b_nbits) - 1);
+                    filter_init(0, a_nbits);
+                    filter_init(1, b_nbits);
+                    // The saved references are masked afresh, as at reset.
+                    a_ref = (uint16_t) (DATAEE_ReadByte(1) << 8) | DATAEE_ReadByte(0);
+                    b_ref = (uint16_t) (DATAEE_ReadByte(3) << 8) | DATAEE_ReadByte(2);
+                    a_ref &= a_mask;
+                    b_ref &= b_mask;
+                    // Outputs that were set up for the old width start again.
+                    if (use_delta_stream) {
+                        delta_stream_flush();
+                        delta_stream_init((a_nbits > b_nbits) ? a_nbits : b_nbits, delta_keyframe);
+                    }
+                    use_deadband = 0;
+                    if (quad_lines) {
+                        quad_out_init(quad_lines, (quad_channel) ? b_nbits : a_nbits, cycle_us);
+                    }
+                } else if (nargs == 2 && args[0] == 3) {
+                    // The I2C bus may already be in use by the AS5600.
+                    if (args[1] && !use_i2c_lcd && !use_i2c_AS5600) { i2c1_init(); }
+                    if (!args[1] && use_i2c_lcd && !use_i2c_AS5600) { i2c1_close(); }
+                    use_i2c_lcd = (args[1] != 0);
+                } else if (nargs == 2 && args[0] == 4) {
+                    if (args[1] && !use_spi_led_display) {
+                        if (quad_lines || use_analog_out || (use_i2c_AS5600 && use_AS5600_pwm)) {
+                            n = printf("O,no-pins\r\n");
+                            break;
+                        }
+                        spi2_init();
+                        max7219_init();
+                    }
+                    if (!args[1] && use_spi_led_display) { spi2_close(); }
+                    use_spi_led_display = (args[1] != 0);
+                } else if (nargs == 2 && args[0] == 5) {
+                    next_AS5600 = (args[1] != 0);
+                } else if (nargs == 2 && args[0] == 6 && args[1] >= 0 && args[1] <= 3) {
+                    next_ssi_types = (uint8_t)args[1];
+                } else if (nargs == 2 && args[0] == 7 && args[1] >= 0 && args[1] <= 16383) {
+                    next_quad_in_lines = (uint16_t)args[1];
+                } else if (nargs == 2 && args[0] == 8) {
+                    next_AS5600_pwm = (args[1] != 0);
+                }
+                n = printf("O,%u,%u,%u,%u,%u,%u,%u,%u,%u\r\n", new_cycle_count, with_rts_cts, aeat_nbits,
+                           use_i2c_lcd, use_spi_led_display, next_AS5600, next_ssi_types,
+                           next_quad_in_lines, next_AS5600_pwm);
+                break;
+            case 'E':
+                // Settings in EEPROM: E1 keeps those of the O and M commands,
+                // noting the switches as they are now; E0 forgets them,
+                // so that the built-in settings and the switches apply.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) {
+                    if (args[0]) {
+                        cfg.cycle_count = new_cycle_count; cfg.rts_cts = with_rts_cts;
+                        cfg.as5600 = next_AS5600; cfg.aeat_12bit = assume_AEAT_12bit;
+                        cfg.ssi_types = next_ssi_types;
+                        cfg.lcd = use_i2c_lcd; cfg.led_display = use_spi_led_display;
+                        cfg.delta_stream = use_delta_stream; cfg.keyframe = delta_keyframe;
+                        cfg.quad_in_lines = next_quad_in_lines; cfg.as5600_pwm = next_AS5600_pwm;
+                        config_save(&cfg, read_switches());
+                    } else {
+                        config_erase();
+                    }
+                }
+                n = printf("E,%u\r\n", config_saved());
+                break;
+            case 'Y':
+                // Time sync: the host sends Y,n and we echo n with our
+                // times (us) for the arrival of that line and for this
+                // reply, followed by the number and time of the latest sample.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                t_reply = timestamp_now();
+                n = printf("Y,%ld,%lu,%lu,%u,%lu\r\n", (nargs == 1) ? args[0] : 0L,
+                           uart1_get_rx_eol_time(), t_reply, sample_seq, t_sample);
+                break;
+            default:
+                n = printf("?\r\n");
+            }
+        } else if (use_uart) {
+            capture_dump_next();
+        }
         // Light LED to indicate slack time.
         // We can use the oscilloscope to measure the slack time,
         // in case we don't allow enough time for the tasks.
+        // We also measure it ourselves, for the W command.
         GREENLED = 1;
-        timer2_wait();
+        t_wait = timestamp_now();
+        // A T line is up to 40 characters.
+        t_send_by = t_sample + cycle_us - 400000000L / uart_baud;
+        if (timer2_wait()) { stats_count(STATS_OVERRUNS); }
+        slack_us = timestamp_now() - t_wait;
+        if (slack_us < min_slack_us) { min_slack_us = slack_us; }
         GREENLED = 0;
+        if (new_cycle_count != cycle_count) {
+            // A cycle period from the O command starts here.
+            timer2_set_period(new_cycle_count);
+            cycle_count = new_cycle_count;
+            cycle_us = cycle_count * CONFIG_US_PER_COUNT;
+            // The G window keeps its length in seconds, and the
+            // quadrature moves are spread over the new cycle, with
+            // fewer lines if the old number would no longer keep up.
+            if (summary_s) { summary_set_interval(summary_cycles(summary_s, cycle_us)); }
+            if (quad_lines > quad_out_max_lines(cycle_us)) {
+                quad_lines = quad_out_max_lines(cycle_us);
+                quad_out_init(quad_lines, (quad_channel) ? b_nbits : a_nbits, cycle_us);
+            } else if (quad_lines) {
+                quad_out_set_cycle(cycle_us);
+            }
+        }
     }
     // Don't actually expect to arrive here but, just to keep things tidy...
+    di();
+    if (use_trigger) { trigger_close(); }
+    if (quad_lines) { quad_out_close(); }
+    if (use_analog_out) { analog_out_close(); }
+    if (use_quad_in) { quad_in_close(); } else { compare_close(); }
+    if (use_i2c_AS5600 && use_AS5600_pwm) { as5600_pwm_close(); }
     timer2_close();
     if (use_i2c_lcd || use_i2c_AS5600) {
         i2c1_close();
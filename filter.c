@@ -0,0 +1,80 @@
+// filter.c
+// Low-pass filter of each channel's raw reading, to quieten the jitter
+// in the last count before it reaches the UART records and the displays.
+// Each stage is the first-order recursion
+//   y += (x - y) / 2^shift
+// and order 2 is two stages in cascade, critically damped.
+// With the sample rate fs, the cutoff of one stage is close to
+//   fs / (2 pi 2^shift)
+// so shift 3 at 20Hz sampling gives 0.4Hz, and the step response
+// takes about 2^shift samples per stage to settle.
+//
+// The readings are angles, so the difference x - y is taken the
+// short way round the turn, modulo 2^nbits, and the state wraps with
+// it; a shaft that sits at 0/4095 (or 0/65535) reads there, not
+// at the half-turn between.  The state keeps FILTER_FRAC_BITS below
+// the count, so that small steps are not lost to truncation.
+//
+// The filter runs on every sample, ahead of the deadband, the delta
+// stream and any reduction in the output rate, so the output
+// is not aliased.  The trigger and burst-capture readings are not
+// filtered.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "filter.h"
+
+static uint8_t order[2] = {0, 0};
+static uint8_t shift[2] = {3, 3};
+static uint8_t primed[2] = {0, 0};
+static uint32_t mask[2] = {0x000fffffUL, 0x000fffffUL}; // state, modulo the turn
+static uint32_t out1[2], out2[2]; // outputs of the two stages
+
+void filter_init(uint8_t ch, uint8_t nbits)
+{
+    if (ch > 1) return;
+    mask[ch] = (1UL << (nbits + FILTER_FRAC_BITS)) - 1;
+    primed[ch] = 0;
+}
+
+void filter_set(uint8_t ch, uint8_t ord, uint8_t sh)
+{
+    if (ch > 1) return;
+    order[ch] = (ord > FILTER_MAX_ORDER) ? FILTER_MAX_ORDER : ord;
+    shift[ch] = (sh > FILTER_MAX_SHIFT) ? FILTER_MAX_SHIFT : sh;
+    primed[ch] = 0; // Start again from the next reading.
+}
+
+uint8_t filter_get_order(uint8_t ch) { return (ch > 1) ? 0 : order[ch]; }
+uint8_t filter_get_shift(uint8_t ch) { return (ch > 1) ? 0 : shift[ch]; }
+
+static uint32_t stage(uint32_t y, uint32_t x, uint32_t m, uint8_t sh)
+// One step of the recursion, with the difference wrapped to +/- half a turn.
+{
+    int32_t d = (int32_t)((x - y) & m);
+    if ((uint32_t)d > (m >> 1)) { d -= (int32_t)(m + 1); }
+    return (y + (uint32_t)(d >> sh)) & m;
+}
+
+uint16_t filter_apply(uint8_t ch, uint16_t raw)
+{
+    uint32_t x, m;
+    if (ch > 1 || order[ch] == 0) return raw;
+    m = mask[ch];
+    x = ((uint32_t)raw << FILTER_FRAC_BITS) & m;
+    if (!primed[ch]) {
+        out1[ch] = x;
+        out2[ch] = x;
+        primed[ch] = 1;
+    }
+    out1[ch] = stage(out1[ch], x, m, shift[ch]);
+    x = out1[ch];
+    if (order[ch] > 1) {
+        out2[ch] = stage(out2[ch], x, m, shift[ch]);
+        x = out2[ch];
+    }
+    // Round to the nearest count.
+    x = ((x + (1UL << (FILTER_FRAC_BITS - 1))) & m) >> FILTER_FRAC_BITS;
+    return (uint16_t)x;
+}
@@ -0,0 +1,19 @@
+// filter.h
+// PJ, 2026-10-18
+
+#ifndef MY_FILTER
+#define MY_FILTER
+
+#include <stdint.h>
+
+#define FILTER_FRAC_BITS 8 // extra resolution kept in the state
+#define FILTER_MAX_ORDER 2
+#define FILTER_MAX_SHIFT 8
+
+void filter_init(uint8_t ch, uint8_t nbits);
+void filter_set(uint8_t ch, uint8_t order, uint8_t shift);
+uint8_t filter_get_order(uint8_t ch);
+uint8_t filter_get_shift(uint8_t ch);
+uint16_t filter_apply(uint8_t ch, uint16_t raw);
+
+#endif
@@ -1,7 +1,11 @@
 // Some definitions that we wish to see globally in our application.
 // PJ, 2018-01-02, 2023-02-02
+//     2026-10-18 FOSC may be selected at build time, e.g. -DFOSC=64000000L
+//                See clock.h for the settings derived from it.
 #ifndef GLOBAL_DEFS
+#ifndef FOSC
 #define FOSC 32000000L
+#endif
 #define _XTAL_FREQ FOSC
 #define GLOBAL_DEFS
 #endif
@@ -0,0 +1,143 @@
+// calib-fit.cpp
+// Fit a nonlinearity correction table for one channel of the readout
+// board (see calib-fit.h) and write it as the board's N commands.
+//
+// The sweep is read as text, one sample per line:
+//   raw,ref
+// where raw is the sensor's reading, in counts of nbits, and ref is the
+// true angle in degrees, from a reference encoder or a dividing head.
+// The channel's table must be off (Nc,0) while the sweep is taken.
+// Lines that do not parse, such as a header, are skipped.
+// The zero and direction of ref need not match the sensor's;
+// the offset is taken out and --reverse turns the direction round.
+//
+// The commands go to stdout, to be sent to the board, and a summary of
+// the fit, with the errors before and after correction, to stderr.
+//
+// Build: g++ -std=c++17 -O2 -o calib-fit calib-fit.cpp
+// Usage: calib-fit [--bits n] [--channel c] [--harmonics k] [--reverse] [sweepfile]
+//
+// PJ, 2026-10-18
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "calib-fit.h"
+
+static double wrap_cdeg(double x)
+{
+    while (x > 18000.0) { x -= 36000.0; }
+    while (x < -18000.0) { x += 36000.0; }
+    return x;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned nbits = 12;
+    unsigned channel = 0;
+    unsigned nharm = 8;
+    bool reverse = false;
+    const char* filename = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { fprintf(stderr, "Missing value for %s\n", arg.c_str()); exit(1); }
+            return argv[++i];
+        };
+        if (arg == "--bits") { nbits = (unsigned)atol(next()); }
+        else if (arg == "--channel") { channel = (unsigned)atol(next()); }
+        else if (arg == "--harmonics") { nharm = (unsigned)atol(next()); }
+        else if (arg == "--reverse") { reverse = true; }
+        else if (arg[0] != '-' && !filename) { filename = argv[i]; }
+        else {
+            fprintf(stderr, "Usage: %s [--bits n] [--channel c] [--harmonics k]"
+                    " [--reverse] [sweepfile]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nbits < 1 || nbits > 16 || channel > 1 || nharm > CALIB_POINTS / 4) {
+        fprintf(stderr, "Need 1-16 bits, channel 0 or 1, and at most %d harmonics\n",
+                CALIB_POINTS / 4);
+        return 1;
+    }
+    std::ifstream file;
+    if (filename) {
+        file.open(filename);
+        if (!file) { std::cerr << "Cannot open " << filename << "\n"; return 1; }
+    }
+    std::istream& in = (filename) ? static_cast<std::istream&>(file) : std::cin;
+
+    const double counts = (double)(1UL << nbits);
+    std::vector<CalibSample> sweep;
+    std::vector<uint32_t> raws;
+    std::string line;
+    size_t skipped = 0;
+    while (std::getline(in, line)) {
+        unsigned long raw;
+        double ref;
+        if (sscanf(line.c_str(), "%lu,%lf", &raw, &ref) != 2 || raw >= (1UL << nbits)) {
+            ++skipped;
+            continue;
+        }
+        if (reverse) { ref = -ref; }
+        double pos = (double)raw / counts;
+        sweep.push_back({pos, ref * 100.0 - pos * 36000.0});
+        raws.push_back((uint32_t)raw);
+    }
+    if (sweep.size() < 2 * (size_t)nharm + 1) {
+        fprintf(stderr, "Too few samples (%zu)\n", sweep.size());
+        return 1;
+    }
+    // Take out the offset as a mean around the circle, so that
+    // the corrections do not straddle the wrap at 180 degrees.
+    double sx = 0.0, sy = 0.0;
+    for (const CalibSample& p : sweep) {
+        sx += std::cos(p.correction * M_PI / 18000.0);
+        sy += std::sin(p.correction * M_PI / 18000.0);
+    }
+    double offset = std::atan2(sy, sx) * 18000.0 / M_PI;
+    for (CalibSample& p : sweep) { p.correction = wrap_cdeg(p.correction - offset); }
+
+    std::vector<double> c;
+    if (!calib_fit_harmonics(sweep, nharm, c)) {
+        fprintf(stderr, "Fit failed; the sweep may not cover enough of the turn\n");
+        return 1;
+    }
+    std::vector<int16_t> table = calib_make_table(c);
+
+    // Errors before and after, about their own means, as the board
+    // sees them once the reference has been subtracted.
+    double mean0 = 0.0, mean1 = 0.0;
+    for (size_t k = 0; k < sweep.size(); ++k) {
+        mean0 += sweep[k].correction;
+        mean1 += sweep[k].correction - calib_interp(table.data(), calib_pos16(raws[k], nbits));
+    }
+    mean0 /= (double)sweep.size();
+    mean1 /= (double)sweep.size();
+    double ss0 = 0.0, ss1 = 0.0, max0 = 0.0, max1 = 0.0;
+    for (size_t k = 0; k < sweep.size(); ++k) {
+        double e0 = sweep[k].correction - mean0;
+        double e1 = sweep[k].correction - calib_interp(table.data(), calib_pos16(raws[k], nbits)) - mean1;
+        ss0 += e0 * e0;
+        ss1 += e1 * e1;
+        max0 = std::max(max0, std::fabs(e0));
+        max1 = std::max(max1, std::fabs(e1));
+    }
+    fprintf(stderr, "%zu samples (%zu lines skipped), offset %.2f deg\n",
+            sweep.size(), skipped, offset / 100.0);
+    for (unsigned h = 1; h <= nharm; ++h) {
+        fprintf(stderr, "harmonic %2u: %7.2f cdeg\n", h, std::hypot(c[2*h - 1], c[2*h]));
+    }
+    fprintf(stderr, "error before: rms %.2f, max %.2f cdeg\n", std::sqrt(ss0 / (double)sweep.size()), max0);
+    fprintf(stderr, "error after:  rms %.2f, max %.2f cdeg\n", std::sqrt(ss1 / (double)sweep.size()), max1);
+
+    for (unsigned i = 0; i < CALIB_POINTS; ++i) { printf("N%u,%u,%d\n", channel, i, table[i]); }
+    printf("N%u,1\n", channel);
+    return 0;
+}
@@ -0,0 +1,128 @@
+// calib-fit.h
+// Fit of a nonlinearity correction table (see calib.c and calib-interp.h
+// in the firmware) from a sweep of a sensor against a reference angle.
+//
+// Each sample of the sweep gives the sensor's raw reading and the true
+// angle.  The correction, true less measured, is first fitted as a
+// sum of harmonics of the turn, which smooths the noise and bridges
+// gaps in the sweep.  The table is then the least-squares fit of the
+// firmware's piecewise-linear interpolation to that sum, evaluated
+// densely around the turn, so that the points sit where the
+// interpolation does best between them rather than on the curve.
+// The constant term is dropped; the reference subtraction in the
+// firmware takes it out anyway.
+//
+// PJ, 2026-10-18
+
+#ifndef CALIB_FIT_H
+#define CALIB_FIT_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "../calib-interp.h"
+
+struct CalibSample {
+    double pos; // sensor reading, in turns, 0 to 1
+    double correction; // true less measured, 1/100 degree
+};
+
+// Solve the square system a*x = b, leaving x in b,
+// by Gaussian elimination with partial pivoting.
+static bool calib_solve(std::vector<double>& a, std::vector<double>& b, size_t n)
+{
+    for (size_t k = 0; k < n; ++k) {
+        size_t p = k;
+        for (size_t i = k + 1; i < n; ++i) {
+            if (std::fabs(a[i*n + k]) > std::fabs(a[p*n + k])) { p = i; }
+        }
+        if (std::fabs(a[p*n + k]) < 1e-12) { return false; }
+        if (p != k) {
+            for (size_t j = 0; j < n; ++j) { std::swap(a[k*n + j], a[p*n + j]); }
+            std::swap(b[k], b[p]);
+        }
+        for (size_t i = k + 1; i < n; ++i) {
+            double f = a[i*n + k] / a[k*n + k];
+            if (f == 0.0) { continue; }
+            for (size_t j = k; j < n; ++j) { a[i*n + j] -= f * a[k*n + j]; }
+            b[i] -= f * b[k];
+        }
+    }
+    for (size_t k = n; k-- > 0; ) {
+        double s = b[k];
+        for (size_t j = k + 1; j < n; ++j) { s -= a[k*n + j] * b[j]; }
+        b[k] = s / a[k*n + k];
+    }
+    return true;
+}
+
+// Harmonic model: c[0] + sum over h of c[2h-1] cos(2 pi h x) + c[2h] sin(2 pi h x).
+static double calib_eval_harmonics(const std::vector<double>& c, double pos)
+{
+    double y = c[0];
+    for (size_t h = 1; 2*h < c.size(); ++h) {
+        double w = 2.0 * M_PI * (double)h * pos;
+        y += c[2*h - 1] * std::cos(w) + c[2*h] * std::sin(w);
+    }
+    return y;
+}
+
+static bool calib_fit_harmonics(const std::vector<CalibSample>& s, unsigned nharm,
+                                std::vector<double>& c)
+{
+    size_t n = 1 + 2 * (size_t)nharm;
+    std::vector<double> a(n * n, 0.0), b(n, 0.0), row(n);
+    for (const CalibSample& p : s) {
+        row[0] = 1.0;
+        for (size_t h = 1; h <= nharm; ++h) {
+            double w = 2.0 * M_PI * (double)h * p.pos;
+            row[2*h - 1] = std::cos(w);
+            row[2*h] = std::sin(w);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < n; ++j) { a[i*n + j] += row[i] * row[j]; }
+            b[i] += row[i] * p.correction;
+        }
+    }
+    if (!calib_solve(a, b, n)) { return false; }
+    c = b;
+    return true;
+}
+
+// Table of CALIB_POINTS corrections, in 1/100 degree, fitted to the model.
+static std::vector<int16_t> calib_make_table(const std::vector<double>& c)
+{
+    const size_t n = CALIB_POINTS;
+    const size_t per_segment = 64;
+    std::vector<double> a(n * n, 0.0), b(n, 0.0);
+    for (size_t k = 0; k < n * per_segment; ++k) {
+        double pos = ((double)k + 0.5) / (double)(n * per_segment);
+        double y = calib_eval_harmonics(c, pos) - c[0];
+        size_t i = k / per_segment;
+        size_t j = (i + 1) % n;
+        double f = ((double)(k % per_segment) + 0.5) / (double)per_segment;
+        double w[2] = {1.0 - f, f};
+        size_t idx[2] = {i, j};
+        for (int u = 0; u < 2; ++u) {
+            for (int v = 0; v < 2; ++v) { a[idx[u]*n + idx[v]] += w[u] * w[v]; }
+            b[idx[u]] += w[u] * y;
+        }
+    }
+    std::vector<int16_t> table(n, 0);
+    if (!calib_solve(a, b, n)) { return table; }
+    for (size_t i = 0; i < n; ++i) {
+        double v = std::round(b[i]);
+        if (v > 32767.0) { v = 32767.0; }
+        if (v < -32768.0) { v = -32768.0; }
+        table[i] = (int16_t)v;
+    }
+    return table;
+}
+
+// Position of a raw reading of nbits, as given to calib_interp().
+static inline uint16_t calib_pos16(uint32_t raw, unsigned nbits)
+{
+    return (uint16_t)(raw << (16 - nbits));
+}
+
+#endif
@@ -0,0 +1,120 @@
+// capture-unpack.cpp
+// Unpack a burst-capture dump sent by the readout board (see capture.c)
+// and write the samples as comma-separated values.
+//
+// The dump arrives mixed in with the board's normal output:
+//   D,nbits,count,trigger_index,total,t_start_us,t_end_us
+//   D:<hex bytes>          (repeated)
+//   D,end
+// Other lines are ignored, so a whole terminal log can be fed in.
+// If there are several dumps, the last complete one is used.
+//
+// Output columns are: index, time (us, estimated from the mean
+// sample period), raw A, raw B, and 1 on the first sample after the trigger.
+//
+// Build: g++ -std=c++17 -O2 -o capture-unpack capture-unpack.cpp
+// Usage: capture-unpack [logfile] > samples.csv
+//
+// PJ, 2026-10-18
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Dump {
+    unsigned nbits = 0, count = 0, trigger_index = 0xffff;
+    unsigned long total = 0, t_start = 0, t_end = 0;
+    std::vector<uint8_t> bytes;
+};
+
+static int hexval(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool unpack(const Dump& d, std::vector<uint16_t>& a, std::vector<uint16_t>& b)
+{
+    const std::vector<uint8_t>& p = d.bytes;
+    for (unsigned i = 0; i < d.count; ++i) {
+        uint16_t va, vb;
+        if (d.nbits == 16) {
+            size_t k = 4 * (size_t)i;
+            if (k + 4 > p.size()) return false;
+            va = (uint16_t)(p[k] << 8 | p[k+1]);
+            vb = (uint16_t)(p[k+2] << 8 | p[k+3]);
+        } else if (d.nbits == 12) {
+            size_t k = 3 * (size_t)i;
+            if (k + 3 > p.size()) return false;
+            va = (uint16_t)(p[k] << 4 | p[k+1] >> 4);
+            vb = (uint16_t)((p[k+1] & 0x0f) << 8 | p[k+2]);
+        } else if (d.nbits == 10) {
+            size_t k = 5 * (size_t)(i / 2);
+            if (k + 5 > p.size()) return false;
+            // 40 bits, most-significant first: A0 B0 A1 B1
+            uint64_t w = 0;
+            for (int j = 0; j < 5; ++j) { w = (w << 8) | p[k+j]; }
+            unsigned shift = (i & 1) ? 0 : 20;
+            va = (uint16_t)((w >> (shift + 10)) & 0x3ff);
+            vb = (uint16_t)((w >> shift) & 0x3ff);
+        } else {
+            return false;
+        }
+        a.push_back(va);
+        b.push_back(vb);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    std::ifstream file;
+    if (argc > 2 || (argc == 2 && std::string(argv[1]) == "--help")) {
+        std::cerr << "Usage: " << argv[0] << " [logfile]\n";
+        return 1;
+    }
+    if (argc == 2) {
+        file.open(argv[1]);
+        if (!file) { std::cerr << "Cannot open " << argv[1] << "\n"; return 1; }
+    }
+    std::istream& in = (argc == 2) ? static_cast<std::istream&>(file) : std::cin;
+    Dump current, last;
+    bool in_dump = false, have_dump = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) { line.pop_back(); }
+        if (line.compare(0, 2, "D:") == 0 && in_dump) {
+            for (size_t i = 2; i + 1 < line.size(); i += 2) {
+                int hi = hexval(line[i]), lo = hexval(line[i+1]);
+                if (hi < 0 || lo < 0) { in_dump = false; break; }
+                current.bytes.push_back((uint8_t)(hi << 4 | lo));
+            }
+        } else if (line == "D,end") {
+            if (in_dump) { last = current; have_dump = true; }
+            in_dump = false;
+        } else if (line.compare(0, 2, "D,") == 0) {
+            current = Dump();
+            in_dump = sscanf(line.c_str() + 2, "%u,%u,%u,%lu,%lu,%lu", &current.nbits, &current.count,
+                             &current.trigger_index, &current.total, &current.t_start, &current.t_end) == 6;
+        }
+    }
+    if (!have_dump) { std::cerr << "No complete capture dump found.\n"; return 1; }
+    std::vector<uint16_t> a, b;
+    if (!unpack(last, a, b)) { std::cerr << "Dump is truncated or has an unknown format.\n"; return 1; }
+    // The newest sample was taken at about t_end.
+    double period = (last.total > 1) ? double(last.t_end - last.t_start) / double(last.total) : 0.0;
+    std::cerr << a.size() << " samples of 2x" << last.nbits << " bits, mean period "
+              << period << " us\n";
+    printf("index,t_us,a_raw,b_raw,trigger\n");
+    for (size_t i = 0; i < a.size(); ++i) {
+        double t = double(last.t_end) - double(a.size() - 1 - i) * period;
+        printf("%zu,%.1f,%u,%u,%d\n", i, t, a[i], b[i], (i == last.trigger_index) ? 1 : 0);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// clock-fit.h
+// Estimate the relation between a board's count (sample number or
+// timer reading) and the host's clock, as a straight line
+//     host_time = offset + rate * (count - origin)
+// fitted by least squares with exponential forgetting, so that the
+// fit follows slow drift of the board's oscillator.
+//
+// Arrival times carry a delay that is never negative but is often
+// large (UART, USB polling, the scheduler), so raw observations are
+// first passed through a lower-envelope filter: of each block of
+// observations, only the one that arrived earliest relative to the
+// current fit is used.  The fitted line therefore tracks the minimum
+// delay, which is close to constant.
+//
+// PJ, 2026-10-18
+
+#ifndef CLOCK_FIT_H
+#define CLOCK_FIT_H
+
+#include <cmath>
+#include <cstdint>
+
+class ClockFit {
+public:
+    // nominal_rate: expected host seconds per count, used until the
+    // first fit is made.  block: observations per envelope point.
+    // forget: weight kept by old points each time a point is added.
+    explicit ClockFit(double nominal_rate, unsigned block = 32, double forget = 0.98)
+        : nominal_rate_(nominal_rate), block_(block ? block : 1), forget_(forget) {}
+
+    // One observation, such as a sample's number and its arrival time.
+    void observe(double count, double host_time)
+    {
+        if (!have_origin_) {
+            have_origin_ = true;
+            x0_ = count;
+            y0_ = host_time;
+        }
+        double x = count - x0_;
+        double y = host_time - y0_;
+        double residual = y - predict_rel(x);
+        if (n_block_ == 0 || residual < best_residual_) {
+            best_residual_ = residual;
+            best_x_ = x;
+            best_y_ = y;
+        }
+        if (++n_block_ >= block_) {
+            add_rel(best_x_, best_y_);
+            n_block_ = 0;
+        }
+    }
+
+    // A point known to lie on the line (up to noise), such as the
+    // midpoint of a short round trip.  It bypasses the envelope filter.
+    void add_point(double count, double host_time)
+    {
+        if (!have_origin_) {
+            have_origin_ = true;
+            x0_ = count;
+            y0_ = host_time;
+        }
+        add_rel(count - x0_, host_time - y0_);
+    }
+
+    // True once there are two points far enough apart to fix the rate.
+    bool valid() const { return valid_; }
+    double rate() const { return valid_ ? rate_ : nominal_rate_; }
+    // Deviation of the rate from nominal, in parts per million.
+    double drift_ppm() const { return (rate() / nominal_rate_ - 1.0) * 1e6; }
+    double host_time(double count) const { return y0_ + predict_rel(count - x0_); }
+    double count_at(double host_time) const
+    {
+        return x0_ + (host_time - y0_ - intercept_) / rate();
+    }
+    uint64_t points() const { return points_; }
+
+private:
+    double predict_rel(double x) const { return intercept_ + rate() * x; }
+
+    void add_rel(double x, double y)
+    {
+        sw_ = forget_ * sw_ + 1.0;
+        sx_ = forget_ * sx_ + x;
+        sy_ = forget_ * sy_ + y;
+        sxx_ = forget_ * sxx_ + x * x;
+        sxy_ = forget_ * sxy_ + x * y;
+        ++points_;
+        double mx = sx_ / sw_;
+        double my = sy_ / sw_;
+        double vxx = sxx_ / sw_ - mx * mx;
+        // Need a spread of counts before the slope means anything.
+        if (points_ >= 2 && vxx > 1e-12 * (mx * mx + 1.0)) {
+            rate_ = (sxy_ / sw_ - mx * my) / vxx;
+            intercept_ = my - rate_ * mx;
+            valid_ = true;
+        } else if (!valid_) {
+            intercept_ = my - nominal_rate_ * mx;
+        }
+    }
+
+    double nominal_rate_;
+    unsigned block_;
+    double forget_;
+    bool have_origin_ = false;
+    double x0_ = 0, y0_ = 0;
+    unsigned n_block_ = 0;
+    double best_residual_ = 0, best_x_ = 0, best_y_ = 0;
+    double sw_ = 0, sx_ = 0, sy_ = 0, sxx_ = 0, sxy_ = 0;
+    uint64_t points_ = 0;
+    bool valid_ = false;
+    double rate_ = 0, intercept_ = 0;
+};
+
+#endif
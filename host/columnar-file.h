@@ -0,0 +1,39 @@
+// columnar-file.h
+// Layout of the columnar sample files written by log-columnar.
+//
+//   ColumnarHeader
+//   chunk 0: a_raw[n] (uint16), b_raw[n] (uint16),
+//            a_cdeg[n] (int16), b_cdeg[n] (int16)
+//   chunk 1: ...
+//   ChunkIndexEntry[nchunks]   at index_offset
+//
+// All values are little-endian.  Angles are in 1/100 degree.
+//
+// PJ, 2026-10-18
+
+#ifndef COLUMNAR_FILE_H
+#define COLUMNAR_FILE_H
+
+#include <cstdint>
+
+const char COLUMNAR_MAGIC[8] = {'R', 'D', 'C', 'O', 'L', '1', 0, 0};
+
+struct ColumnarHeader {
+    char magic[8];
+    uint32_t ncolumns; // 4
+    uint32_t nchunks;
+    uint64_t nrows;
+    uint64_t index_offset; // of the chunk index, from the start of the file
+    uint64_t skipped_lines; // lines in the log that were not samples
+};
+static_assert(sizeof(ColumnarHeader) == 40, "ColumnarHeader layout is part of the file format");
+
+struct ChunkIndexEntry {
+    uint64_t first_row;
+    uint64_t offset; // of the chunk's first column
+    uint32_t nrows;
+    uint32_t reserved;
+};
+static_assert(sizeof(ChunkIndexEntry) == 24, "ChunkIndexEntry layout is part of the file format");
+
+#endif
@@ -0,0 +1,42 @@
+// delta-decode.cpp
+// Reconstruct the raw sample sequence from a log of the board's
+// compressed output and write it as comma-separated values.
+// Lines other than the compressed "Z" lines are ignored.
+//
+// Build: g++ -std=c++17 -O2 -o delta-decode delta-decode.cpp delta-stream.cpp
+// Usage: delta-decode [logfile] > samples.csv
+//
+// PJ, 2026-10-18
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "delta-stream.h"
+
+int main(int argc, char* argv[])
+{
+    std::ifstream file;
+    if (argc > 2 || (argc == 2 && std::string(argv[1]) == "--help")) {
+        std::cerr << "Usage: " << argv[0] << " [logfile]\n";
+        return 1;
+    }
+    if (argc == 2) {
+        file.open(argv[1]);
+        if (!file) { std::cerr << "Cannot open " << argv[1] << "\n"; return 1; }
+    }
+    std::istream& in = (argc == 2) ? static_cast<std::istream&>(file) : std::cin;
+    DeltaStreamDecoder decoder;
+    std::vector<RawSample> samples;
+    std::string line;
+    printf("seq,a_raw,b_raw\n");
+    while (std::getline(in, line)) {
+        samples.clear();
+        decoder.feed_line(line.data(), line.size(), samples);
+        for (const auto& s : samples) { printf("%u,%u,%u\n", s.seq, s.a, s.b); }
+    }
+    std::cerr << "lines lost " << decoder.lines_lost() << ", samples lost "
+              << decoder.samples_lost() << ", bad lines " << decoder.bad_lines() << "\n";
+    return 0;
+}
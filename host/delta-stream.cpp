@@ -0,0 +1,110 @@
+// delta-stream.cpp
+// Decoder for the compressed "Z" lines sent by the readout board.
+// PJ, 2026-10-18
+
+#include "delta-stream.h"
+
+bool DeltaStreamDecoder::feed_line(const char* line, size_t len, std::vector<RawSample>& out)
+{
+    while (len > 0 && (line[len-1] == '\r' || line[len-1] == '\n')) { --len; }
+    if (len < 3 || line[0] != 'Z') return false;
+    // Undo the 3-bytes-to-4-characters coding.
+    bytes_.clear();
+    uint32_t acc = 0;
+    int nacc = 0;
+    for (size_t i = 1; i < len; ++i) {
+        int v = line[i] - '0';
+        if (v < 0 || v > 63) { ++bad_lines_; synced_ = false; return false; }
+        acc = (acc << 6) | (uint32_t)v;
+        nacc += 6;
+        if (nacc >= 8) {
+            nacc -= 8;
+            bytes_.push_back((uint8_t)(acc >> nacc));
+            acc &= (1u << nacc) - 1;
+        }
+    }
+    if (bytes_.size() < 2) { ++bad_lines_; return false; }
+    uint8_t count = bytes_[0];
+    if (have_line_count_ && count != next_line_count_) {
+        lines_lost_ += (uint8_t)(count - next_line_count_);
+        synced_ = false; // Until the next keyframe.
+    }
+    have_line_count_ = true;
+    next_line_count_ = (uint8_t)(count + 1);
+    if (!synced_ && bytes_[1] != 0xff) return true; // Wait for a keyframe.
+    if (!decode_records(bytes_.data() + 1, bytes_.size() - 1, out)) {
+        ++bad_lines_;
+        synced_ = false;
+    }
+    return true;
+}
+
+void DeltaStreamDecoder::emit(std::vector<RawSample>& out)
+{
+    out.push_back(RawSample{seq_, a_, b_});
+    ++seq_;
+}
+
+static bool get_varint(const uint8_t*& p, const uint8_t* end, int32_t& d)
+{
+    uint32_t z = 0;
+    for (int shift = 0; shift < 21; shift += 7) {
+        if (p == end) return false;
+        uint8_t byte = *p++;
+        z |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1); // undo zig-zag
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeltaStreamDecoder::decode_records(const uint8_t* p, size_t n, std::vector<RawSample>& out)
+{
+    const uint8_t* end = p + n;
+    while (p < end) {
+        uint8_t tag = *p++;
+        if (tag == 0xff) {
+            if (end - p < 7) return false;
+            unsigned nbits = p[0];
+            if (nbits < 1 || nbits > 16) return false;
+            uint16_t seq16 = (uint16_t)(p[1] << 8 | p[2]);
+            // Extend the board's 16-bit sample counter.
+            uint32_t seq = (seq_ & 0xffff0000u) | seq16;
+            if (have_seq_) {
+                if (seq < seq_) seq += 0x10000u;
+                samples_lost_ += seq - seq_;
+            }
+            seq_ = seq;
+            have_seq_ = true;
+            nbits_ = nbits;
+            mask_ = (nbits >= 16) ? 0xffff : (uint16_t)((1u << nbits) - 1);
+            a_ = (uint16_t)(p[3] << 8 | p[4]) & mask_;
+            b_ = (uint16_t)(p[5] << 8 | p[6]) & mask_;
+            p += 7;
+            synced_ = true;
+            emit(out);
+        } else if (!synced_) {
+            return false;
+        } else if ((tag & 0xc0) == 0x00) {
+            int da = (tag >> 3) & 0x07, db = tag & 0x07;
+            if (da > 3) da -= 8;
+            if (db > 3) db -= 8;
+            a_ = (uint16_t)(a_ + da) & mask_;
+            b_ = (uint16_t)(b_ + db) & mask_;
+            emit(out);
+        } else if ((tag & 0xc0) == 0x40) {
+            for (int i = 0; i <= (tag & 0x3f); ++i) { emit(out); }
+        } else if (tag == 0x80) {
+            int32_t da, db;
+            if (!get_varint(p, end, da) || !get_varint(p, end, db)) return false;
+            a_ = (uint16_t)(a_ + da) & mask_;
+            b_ = (uint16_t)(b_ + db) & mask_;
+            emit(out);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+// delta-stream.h
+// Decoder for the compressed "Z" lines sent by the readout board
+// (see delta-stream.c in the firmware for the format).
+// PJ, 2026-10-18
+
+#ifndef DELTA_STREAM_H
+#define DELTA_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct RawSample {
+    uint32_t seq; // Sample number, counted by the board (extended beyond 16 bits).
+    uint16_t a;
+    uint16_t b;
+};
+
+class DeltaStreamDecoder {
+public:
+    // Decode one line of text (with or without its trailing \r\n).
+    // Lines that do not start with 'Z' are ignored and return false.
+    // Samples are appended to out.
+    bool feed_line(const char* line, size_t len, std::vector<RawSample>& out);
+
+    // Counters for the host to judge link quality.
+    uint64_t lines_lost() const { return lines_lost_; }
+    uint64_t samples_lost() const { return samples_lost_; }
+    uint64_t bad_lines() const { return bad_lines_; }
+    bool synced() const { return synced_; }
+
+private:
+    bool decode_records(const uint8_t* p, size_t n, std::vector<RawSample>& out);
+    void emit(std::vector<RawSample>& out);
+
+    bool synced_ = false;
+    bool have_line_count_ = false;
+    uint8_t next_line_count_ = 0;
+    unsigned nbits_ = 12;
+    uint16_t mask_ = 0x0fff;
+    uint16_t a_ = 0, b_ = 0;
+    uint32_t seq_ = 0; // of the next sample
+    bool have_seq_ = false;
+    uint64_t lines_lost_ = 0, samples_lost_ = 0, bad_lines_ = 0;
+    std::vector<uint8_t> bytes_;
+};
+
+#endif
@@ -0,0 +1,446 @@
+// log-columnar.cpp
+// Convert a recorded log of the board's sample lines to a columnar
+// binary file (see columnar-file.h).
+//
+// The board writes each sample as "%4u,%4u,%s\r\n", where the string
+// comes from values_to_string_buffer() and has fixed columns, so almost
+// every line is exactly 27 bytes:
+//   0         1         2
+//   012345678901234567890123456
+//   aaaa,bbbb,sAAA.AA,sBBB.BB\r\n
+// Lines of that form are parsed with SIMD instructions, 2 at a time
+// with AVX2 or 1 at a time with SSSE3 (which supplies the byte shuffle
+// and multiply-add that plain SSE2 lacks).  Any other line, such as one
+// with the deadband sequence numbers, a 16-bit Lika reading or a
+// message from the board, goes to a scalar parser; lines that are not
+// samples are counted and skipped.
+//
+// The log is memory-mapped and split into pieces at line boundaries;
+// pieces are parsed by a pool of threads and written in order, one
+// chunk per piece.
+//
+// Build: g++ -std=c++17 -O2 -pthread -o log-columnar log-columnar.cpp
+// Usage: log-columnar [-j threads] logfile outfile
+//        log-columnar [-j threads] --bench logfile
+// With --bench, nothing is written; each parser is timed on the whole
+// log, checked against the scalar parser, and its speed reported in GB/s.
+//
+// PJ, 2026-10-18
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "columnar-file.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#else
+#define HAVE_X86_SIMD 0
+#endif
+
+enum Parser { PARSER_SCALAR, PARSER_SSSE3, PARSER_AVX2 };
+static const char* parser_names[] = {"scalar", "ssse3", "avx2"};
+
+struct Columns {
+    std::vector<uint16_t> a, b;
+    std::vector<int16_t> a_cdeg, b_cdeg;
+    size_t n = 0;
+    uint64_t skipped = 0;
+
+    void reserve(size_t rows)
+    {
+        a.resize(rows); b.resize(rows); a_cdeg.resize(rows); b_cdeg.resize(rows);
+    }
+};
+
+const size_t FIXED_LINE_LEN = 27;
+
+// Scalar parser for one line [p, end) without its line break.
+// Accepts the raw values in any width and ignores fields after the angles.
+static bool parse_line_scalar(const char* p, const char* end, Columns& c)
+{
+    uint32_t raw[2];
+    int32_t cdeg[2];
+    for (int i = 0; i < 2; ++i) {
+        while (p < end && *p == ' ') ++p;
+        if (p == end || (unsigned)(*p - '0') > 9) return false;
+        uint32_t x = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9) {
+            x = x * 10 + (uint32_t)(*p++ - '0');
+            if (x > 0xffff) return false;
+        }
+        if (p == end || *p++ != ',') return false;
+        raw[i] = x;
+    }
+    for (int i = 0; i < 2; ++i) {
+        while (p < end && *p == ' ') ++p;
+        bool negative = (p < end && *p == '-');
+        if (negative) ++p;
+        int32_t x = 0;
+        int ndigits = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9 && ndigits < 5) {
+            x = x * 10 + (*p++ - '0');
+            ++ndigits;
+        }
+        if (ndigits == 0 || p == end || *p++ != '.') return false;
+        for (int j = 0; j < 2; ++j) {
+            if (p == end || (unsigned)(*p - '0') > 9) return false;
+            x = x * 10 + (*p++ - '0');
+        }
+        if (x > 32767) return false;
+        cdeg[i] = negative ? -x : x;
+        if (p < end && *p++ != ',') return false;
+    }
+    c.a[c.n] = (uint16_t)raw[0];
+    c.b[c.n] = (uint16_t)raw[1];
+    c.a_cdeg[c.n] = (int16_t)cdeg[0];
+    c.b_cdeg[c.n] = (int16_t)cdeg[1];
+    ++c.n;
+    return true;
+}
+
+#if HAVE_X86_SIMD
+// The two 16-byte loads of a fixed line, at offsets 0 and 11, and
+// what is checked in each.  Bit i of a mask stands for byte i.
+const unsigned LO_DIGIT_OR_SPACE = 0x01ef; // raw A 0-3, raw B 5-8
+const unsigned LO_PUNCT = 0x0210; // ',' at 4 and 9
+const unsigned HI_DIGIT = 0x3737; // 11-13, 15-16, 19-21, 23-24
+const unsigned HI_PUNCT = 0xc848; // '.' at 14, ',' at 17, '.' at 22, \r\n
+
+
+// Once the bytes are checked, the digits are gathered into four groups
+// of four and combined with multiply-adds into raw A, raw B and the low
+// 4 digits of each angle.  Each angle's hundreds digit and sign are
+// added afterwards.
+__attribute__((target("ssse3")))
+static bool parse_fixed_ssse3(const char* p, Columns& c)
+{
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i lo_punct = _mm_setr_epi8(0, 0, 0, 0, ',', 0, 0, 0, 0, ',', 0, 0, 0, 0, 0, 0);
+    const __m128i hi_punct = _mm_setr_epi8(0, 0, 0, '.', 0, 0, ',', 0, 0, 0, 0, '.', 0, 0, '\r', '\n');
+    __m128i lo = _mm_loadu_si128((const __m128i*)p);
+    __m128i hi = _mm_loadu_si128((const __m128i*)(p + 11));
+    __m128i d_lo = _mm_sub_epi8(lo, zero_char);
+    __m128i d_hi = _mm_sub_epi8(hi, zero_char);
+    __m128i lo_digit = _mm_cmpeq_epi8(_mm_min_epu8(d_lo, nine), d_lo);
+    __m128i hi_digit = _mm_cmpeq_epi8(_mm_min_epu8(d_hi, nine), d_hi);
+    unsigned m_lo = (unsigned)_mm_movemask_epi8(_mm_or_si128(lo_digit, _mm_cmpeq_epi8(lo, space)));
+    unsigned p_lo = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, lo_punct));
+    unsigned m_hi = (unsigned)_mm_movemask_epi8(hi_digit);
+    unsigned p_hi = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, hi_punct));
+    if ((m_lo & LO_DIGIT_OR_SPACE) != LO_DIGIT_OR_SPACE || (p_lo & LO_PUNCT) != LO_PUNCT ||
+        (m_hi & HI_DIGIT) != HI_DIGIT || (p_hi & HI_PUNCT) != HI_PUNCT ||
+        (p[10] != ' ' && p[10] != '-') || (p[18] != ' ' && p[18] != '-')) {
+        return false;
+    }
+    d_lo = _mm_and_si128(d_lo, lo_digit); // leading spaces count as 0
+    __m128i x = _mm_or_si128(
+        _mm_shuffle_epi8(d_lo, _mm_setr_epi8(0, 1, 2, 3, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(d_hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 4, 5, 9, 10, 12, 13)));
+    __m128i v = _mm_madd_epi16(_mm_maddubs_epi16(x, _mm_set1_epi16(0x010a)), _mm_set1_epi32(0x00010064));
+    alignas(16) int32_t out[4];
+    _mm_store_si128((__m128i*)out, v);
+    int32_t a_cdeg = out[2] + (p[11] - '0') * 10000;
+    int32_t b_cdeg = out[3] + (p[19] - '0') * 10000;
+    if (a_cdeg > 32767 || b_cdeg > 32767) return false;
+    c.a[c.n] = (uint16_t)out[0];
+    c.b[c.n] = (uint16_t)out[1];
+    c.a_cdeg[c.n] = (int16_t)(p[10] == '-' ? -a_cdeg : a_cdeg);
+    c.b_cdeg[c.n] = (int16_t)(p[18] == '-' ? -b_cdeg : b_cdeg);
+    ++c.n;
+    return true;
+}
+
+// Two consecutive fixed lines, one in each 128-bit lane.
+__attribute__((target("avx2")))
+static bool parse_fixed_pair_avx2(const char* p, Columns& c)
+{
+    const __m256i zero_char = _mm256_set1_epi8('0');
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i lo_punct = _mm256_setr_epi8(
+        0, 0, 0, 0, ',', 0, 0, 0, 0, ',', 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, ',', 0, 0, 0, 0, ',', 0, 0, 0, 0, 0, 0);
+    const __m256i hi_punct = _mm256_setr_epi8(
+        0, 0, 0, '.', 0, 0, ',', 0, 0, 0, 0, '.', 0, 0, '\r', '\n',
+        0, 0, 0, '.', 0, 0, ',', 0, 0, 0, 0, '.', 0, 0, '\r', '\n');
+    const char* q = p + FIXED_LINE_LEN;
+    __m256i lo = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+        _mm_loadu_si128((const __m128i*)q), 1);
+    __m256i hi = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(p + 11))),
+        _mm_loadu_si128((const __m128i*)(q + 11)), 1);
+    __m256i d_lo = _mm256_sub_epi8(lo, zero_char);
+    __m256i d_hi = _mm256_sub_epi8(hi, zero_char);
+    __m256i lo_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d_lo, nine), d_lo);
+    __m256i hi_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d_hi, nine), d_hi);
+    uint32_t m_lo = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(lo_digit, _mm256_cmpeq_epi8(lo, space)));
+    uint32_t p_lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, lo_punct));
+    uint32_t m_hi = (uint32_t)_mm256_movemask_epi8(hi_digit);
+    uint32_t p_hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, hi_punct));
+    const uint32_t lo_digit_mask = LO_DIGIT_OR_SPACE * 0x10001u;
+    const uint32_t lo_punct_mask = LO_PUNCT * 0x10001u;
+    const uint32_t hi_digit_mask = HI_DIGIT * 0x10001u;
+    const uint32_t hi_punct_mask = HI_PUNCT * 0x10001u;
+    if ((m_lo & lo_digit_mask) != lo_digit_mask || (p_lo & lo_punct_mask) != lo_punct_mask ||
+        (m_hi & hi_digit_mask) != hi_digit_mask || (p_hi & hi_punct_mask) != hi_punct_mask ||
+        (p[10] != ' ' && p[10] != '-') || (p[18] != ' ' && p[18] != '-') ||
+        (q[10] != ' ' && q[10] != '-') || (q[18] != ' ' && q[18] != '-')) {
+        return false;
+    }
+    d_lo = _mm256_and_si256(d_lo, lo_digit);
+    __m256i x = _mm256_or_si256(
+        _mm256_shuffle_epi8(d_lo, _mm256_setr_epi8(
+            0, 1, 2, 3, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1,
+            0, 1, 2, 3, 5, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm256_shuffle_epi8(d_hi, _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 4, 5, 9, 10, 12, 13,
+            -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 4, 5, 9, 10, 12, 13)));
+    __m256i v = _mm256_madd_epi16(_mm256_maddubs_epi16(x, _mm256_set1_epi16(0x010a)),
+                                  _mm256_set1_epi32(0x00010064));
+    alignas(32) int32_t out[8];
+    _mm256_store_si256((__m256i*)out, v);
+    int32_t cdeg[4] = {out[2] + (p[11] - '0') * 10000, out[3] + (p[19] - '0') * 10000,
+                       out[6] + (q[11] - '0') * 10000, out[7] + (q[19] - '0') * 10000};
+    if (cdeg[0] > 32767 || cdeg[1] > 32767 || cdeg[2] > 32767 || cdeg[3] > 32767) return false;
+    size_t n = c.n;
+    c.a[n] = (uint16_t)out[0];
+    c.b[n] = (uint16_t)out[1];
+    c.a_cdeg[n] = (int16_t)(p[10] == '-' ? -cdeg[0] : cdeg[0]);
+    c.b_cdeg[n] = (int16_t)(p[18] == '-' ? -cdeg[1] : cdeg[1]);
+    c.a[n+1] = (uint16_t)out[4];
+    c.b[n+1] = (uint16_t)out[5];
+    c.a_cdeg[n+1] = (int16_t)(q[10] == '-' ? -cdeg[2] : cdeg[2]);
+    c.b_cdeg[n+1] = (int16_t)(q[18] == '-' ? -cdeg[3] : cdeg[3]);
+    c.n = n + 2;
+    return true;
+}
+#endif
+
+// Parse the whole lines in [p, end) and append them to c.
+static void parse_range(const char* p, const char* end, Parser parser, Columns& c)
+{
+    // Worst case, every line is a minimal sample "0,0,0.00,0.00\n".
+    c.reserve(c.n + (size_t)(end - p) / 15 + 1);
+    while (p < end) {
+#if HAVE_X86_SIMD
+        size_t left = (size_t)(end - p);
+        if (parser == PARSER_AVX2 && left >= 2 * FIXED_LINE_LEN &&
+            parse_fixed_pair_avx2(p, c)) {
+            p += 2 * FIXED_LINE_LEN;
+            continue;
+        }
+        if (parser != PARSER_SCALAR && left >= FIXED_LINE_LEN && parse_fixed_ssse3(p, c)) {
+            p += FIXED_LINE_LEN;
+            continue;
+        }
+#endif
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        const char* line_end = nl ? nl : end;
+        const char* text_end = (line_end > p && line_end[-1] == '\r') ? line_end - 1 : line_end;
+        if (!parse_line_scalar(p, text_end, c)) ++c.skipped;
+        p = nl ? nl + 1 : end;
+    }
+}
+
+static Parser best_parser()
+{
+#if HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return PARSER_AVX2;
+    if (__builtin_cpu_supports("ssse3")) return PARSER_SSSE3;
+#endif
+    return PARSER_SCALAR;
+}
+
+// Split [begin, end) into about n pieces that end at line breaks.
+static std::vector<const char*> split_at_lines(const char* begin, const char* end, size_t n)
+{
+    std::vector<const char*> cuts{begin};
+    size_t step = (size_t)(end - begin) / n + 1;
+    const char* p = begin;
+    while ((size_t)(end - p) > step) {
+        const char* nl = static_cast<const char*>(memchr(p + step, '\n', (size_t)(end - p - step)));
+        if (!nl) break;
+        p = nl + 1;
+        cuts.push_back(p);
+    }
+    cuts.push_back(end);
+    return cuts;
+}
+
+static void parse_pieces(const std::vector<const char*>& cuts, size_t first, size_t count,
+                         Parser parser, std::vector<Columns>& out)
+{
+    std::vector<std::thread> pool;
+    for (size_t i = 0; i < count; ++i) {
+        out[i].n = 0;
+        out[i].skipped = 0;
+        pool.emplace_back(parse_range, cuts[first + i], cuts[first + i + 1], parser, std::ref(out[i]));
+    }
+    for (auto& t : pool) t.join();
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static int bench(const char* data, size_t size, unsigned nthreads)
+{
+    Parser best = best_parser();
+    Columns reference;
+    double gb = (double)size * 1e-9;
+    for (int p = PARSER_SCALAR; p <= best; ++p) {
+        Columns c;
+        auto t0 = std::chrono::steady_clock::now();
+        parse_range(data, data + size, (Parser)p, c);
+        double s = seconds_since(t0);
+        bool same = true;
+        if (p == PARSER_SCALAR) {
+            reference = std::move(c);
+        } else {
+            same = c.n == reference.n && c.skipped == reference.skipped &&
+                   std::equal(c.a.begin(), c.a.begin() + c.n, reference.a.begin()) &&
+                   std::equal(c.b.begin(), c.b.begin() + c.n, reference.b.begin()) &&
+                   std::equal(c.a_cdeg.begin(), c.a_cdeg.begin() + c.n, reference.a_cdeg.begin()) &&
+                   std::equal(c.b_cdeg.begin(), c.b_cdeg.begin() + c.n, reference.b_cdeg.begin());
+        }
+        printf("%-7s  1 thread  %6.2f GB/s%s\n", parser_names[p], gb / s,
+               same ? "" : "  MISMATCH with scalar");
+        if (!same) return 1;
+    }
+    std::vector<const char*> cuts = split_at_lines(data, data + size, nthreads);
+    std::vector<Columns> pieces(cuts.size() - 1);
+    auto t0 = std::chrono::steady_clock::now();
+    parse_pieces(cuts, 0, pieces.size(), best, pieces);
+    double s = seconds_since(t0);
+    printf("%-7s %2u thread%s %6.2f GB/s\n", parser_names[best], nthreads,
+           nthreads == 1 ? " " : "s", gb / s);
+    printf("%zu samples, %llu other lines\n", reference.n, (unsigned long long)reference.skipped);
+    return 0;
+}
+
+static bool write_all(int fd, const void* buf, size_t len, off_t offset)
+{
+    const char* p = static_cast<const char*>(buf);
+    while (len > 0) {
+        ssize_t w = pwrite(fd, p, len, offset);
+        if (w <= 0) return false;
+        p += w; len -= (size_t)w; offset += w;
+    }
+    return true;
+}
+
+static int convert(const char* data, size_t size, unsigned nthreads, const char* out_path)
+{
+    int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { fprintf(stderr, "Cannot create %s\n", out_path); return 1; }
+    // Pieces of about 16MB, parsed nthreads at a time, keep the memory
+    // needed independent of the size of the log.
+    const size_t piece_bytes = 16u << 20;
+    std::vector<const char*> cuts = split_at_lines(data, data + size, size / piece_bytes + 1);
+    size_t npieces = cuts.size() - 1;
+    Parser parser = best_parser();
+    std::vector<Columns> batch(nthreads);
+    std::vector<ChunkIndexEntry> index;
+    ColumnarHeader hdr{};
+    memcpy(hdr.magic, COLUMNAR_MAGIC, sizeof(hdr.magic));
+    hdr.ncolumns = 4;
+    off_t offset = sizeof(hdr);
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < npieces; first += nthreads) {
+        size_t count = std::min<size_t>(nthreads, npieces - first);
+        parse_pieces(cuts, first, count, parser, batch);
+        for (size_t i = 0; i < count; ++i) {
+            const Columns& c = batch[i];
+            hdr.skipped_lines += c.skipped;
+            if (c.n == 0) continue;
+            ChunkIndexEntry e{};
+            e.first_row = hdr.nrows;
+            e.offset = (uint64_t)offset;
+            e.nrows = (uint32_t)c.n;
+            size_t col = c.n * sizeof(uint16_t);
+            if (!write_all(fd, c.a.data(), col, offset) ||
+                !write_all(fd, c.b.data(), col, offset + (off_t)col) ||
+                !write_all(fd, c.a_cdeg.data(), col, offset + 2 * (off_t)col) ||
+                !write_all(fd, c.b_cdeg.data(), col, offset + 3 * (off_t)col)) {
+                fprintf(stderr, "Write to %s failed\n", out_path);
+                close(fd);
+                return 1;
+            }
+            offset += 4 * (off_t)col;
+            hdr.nrows += c.n;
+            index.push_back(e);
+        }
+    }
+    hdr.nchunks = (uint32_t)index.size();
+    hdr.index_offset = (uint64_t)offset;
+    if (!write_all(fd, index.data(), index.size() * sizeof(ChunkIndexEntry), offset) ||
+        !write_all(fd, &hdr, sizeof(hdr), 0)) {
+        fprintf(stderr, "Write to %s failed\n", out_path);
+        close(fd);
+        return 1;
+    }
+    close(fd);
+    double s = seconds_since(t0);
+    fprintf(stderr, "%llu samples in %u chunks, %llu other lines; %.2f GB/s with %s\n",
+            (unsigned long long)hdr.nrows, hdr.nchunks, (unsigned long long)hdr.skipped_lines,
+            (double)size * 1e-9 / s, parser_names[parser]);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+    bool do_bench = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) { nthreads = std::max(1, atoi(argv[++i])); }
+        else if (arg == "--bench") { do_bench = true; }
+        else if (arg[0] == '-') { files.clear(); break; }
+        else { files.push_back(arg); }
+    }
+    if (files.size() != (do_bench ? 1u : 2u)) {
+        fprintf(stderr, "Usage: %s [-j threads] logfile outfile\n"
+                "       %s [-j threads] --bench logfile\n", argv[0], argv[0]);
+        return 1;
+    }
+    int fd = open(files[0].c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Cannot open %s\n", files[0].c_str());
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        fprintf(stderr, "%s is empty\n", files[0].c_str());
+        return 1;
+    }
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Cannot map %s\n", files[0].c_str());
+        return 1;
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(map);
+    int status = do_bench ? bench(data, size, nthreads) : convert(data, size, nthreads, files[1].c_str());
+    munmap(map, size);
+    return status;
+}
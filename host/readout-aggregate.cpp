@@ -0,0 +1,294 @@
+// readout-aggregate.cpp
+// Merge the output of several readout boards into one stream of
+// samples on a common timebase.
+//
+// Each board free-runs its own sample period, so its sample numbers
+// are related to host time by a straight line whose offset and slope
+// differ from board to board and drift slowly.  For every board the
+// line is fitted to the sample numbers and the arrival times of the
+// lines that carry them (clock-fit.h).  The merged output then
+// interpolates each board's angles at regular instants of host time.
+//
+// The boards should send text samples.  With the deadband in use (Q),
+// each line carries the board's sample number; otherwise lines are
+// counted, and a lost line will appear as a step in that board's fit.
+//
+// There is one reader thread per port, which parses lines and passes
+// samples through a single-producer single-consumer queue to the merge
+// stage in the main thread, so no locks are taken anywhere.
+//
+// Output, to stdout:
+//   t,a0,b0,a1,b1,...
+// with t in seconds of host (CLOCK_REALTIME) time and the angles in
+// degrees; a board with no data near t leaves its fields empty.
+//
+// Build: g++ -std=c++17 -O2 -pthread -o readout-aggregate readout-aggregate.cpp
+// Usage: readout-aggregate [-b baud] [-p period_ms] [-g grid_ms] device...
+//   -p  nominal sample period of the boards (default 50)
+//   -g  interval of the merged output (default 10)
+//
+// PJ, 2026-10-18
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "clock-fit.h"
+#include "readout-parse.h"
+#include "serial-port.h"
+
+static std::atomic<bool> stop_requested{false};
+static void on_signal(int) { stop_requested = true; }
+
+static double now_s()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double)ts.tv_sec + 1e-9 * (double)ts.tv_nsec;
+}
+
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+public:
+    bool push(const T& item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_cache_ == N) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head - tail_cache_ == N) return false;
+        }
+        buf_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail == head_cache_) return false;
+        }
+        item = buf_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, N> buf_;
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tail_cache_ = 0; // producer's copy
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t head_cache_ = 0; // consumer's copy
+};
+
+struct BoardSample {
+    uint64_t seq;
+    double host_time;
+    int32_t a_cdeg, b_cdeg;
+};
+
+struct Board {
+    std::string device;
+    int fd = -1;
+    SpscQueue<BoardSample, 4096> queue;
+    // Written by the reader thread, read at the end.
+    std::atomic<uint64_t> lines{0}, samples{0}, dropped{0};
+    // Merge-stage state.
+    std::unique_ptr<ClockFit> fit;
+    std::deque<BoardSample> history;
+};
+
+static void read_board(Board* board)
+{
+    static const size_t BUF_LEN = 4096;
+    char buf[BUF_LEN];
+    size_t held = 0;
+    uint64_t line_count = 0;
+    bool have_seq = false;
+    uint64_t seq = 0;
+    while (!stop_requested) {
+        ssize_t got = read(board->fd, buf + held, BUF_LEN - held);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "%s: read failed: %s\n", board->device.c_str(), strerror(errno));
+            return;
+        }
+        if (got == 0) { usleep(10000); continue; }
+        double t = now_s();
+        const char* p = buf;
+        const char* end = buf + held + got;
+        for (;;) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+            if (!nl) break;
+            const char* line_end = (nl > p && nl[-1] == '\r') ? nl - 1 : nl;
+            Record r{};
+            if (line_end > p && parse_sample(p, line_end, r)) {
+                board->lines.fetch_add(1, std::memory_order_relaxed);
+                if (r.flags & FLAG_HAS_SEQ) {
+                    // The board's sample number is 16 bits.
+                    if (!have_seq) { seq = r.board_seq; have_seq = true; }
+                    else { seq += (uint16_t)(r.board_seq - (uint16_t)seq); }
+                } else {
+                    seq = line_count;
+                }
+                ++line_count;
+                if (board->queue.push(BoardSample{seq, t, r.a_cdeg, r.b_cdeg})) {
+                    board->samples.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    board->dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            p = nl + 1;
+        }
+        held = (size_t)(end - p);
+        if (held == BUF_LEN) { held = 0; }
+        else if (held && p != buf) { memmove(buf, p, held); }
+    }
+}
+
+// Interpolate between two angles in 1/100 degree, the short way round.
+static double interpolate_cdeg(int32_t a0, int32_t a1, double f)
+{
+    double d = (double)(a1 - a0);
+    if (d > 18000) d -= 36000;
+    if (d < -18000) d += 36000;
+    double v = a0 + f * d;
+    if (v > 18000) v -= 36000;
+    if (v < -18000) v += 36000;
+    return v;
+}
+
+int main(int argc, char* argv[])
+{
+    long baud = 115200;
+    double period_s = 0.050;
+    double grid_s = 0.010;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:p:g:h")) != -1) {
+        switch (opt) {
+        case 'b': baud = strtol(optarg, nullptr, 10); break;
+        case 'p': period_s = atof(optarg) * 1e-3; break;
+        case 'g': grid_s = atof(optarg) * 1e-3; break;
+        default:
+            fprintf(stderr, "Usage: %s [-b baud] [-p period_ms] [-g grid_ms] device...\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || period_s <= 0 || grid_s <= 0) {
+        fprintf(stderr, "Usage: %s [-b baud] [-p period_ms] [-g grid_ms] device...\n", argv[0]);
+        return 1;
+    }
+    std::vector<std::unique_ptr<Board>> boards;
+    for (int i = optind; i < argc; ++i) {
+        auto b = std::make_unique<Board>();
+        b->device = argv[i];
+        b->fd = open_serial(argv[i], baud);
+        if (b->fd < 0) return 1;
+        b->fit = std::make_unique<ClockFit>(period_s);
+        boards.push_back(std::move(b));
+    }
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    // Readers blocked in read() are signalled again at the end, to wake them.
+    std::vector<std::thread> readers;
+    for (auto& b : boards) readers.emplace_back(read_board, b.get());
+
+    // A board with nothing newer than this, after an output instant,
+    // is left out of that instant rather than holding up the others.
+    const double max_wait_s = 0.5 + 4 * period_s;
+    double next_t = 0; // next output instant, 0 until started
+    std::string row;
+    printf("t");
+    for (size_t i = 0; i < boards.size(); ++i) printf(",a%zu,b%zu", i, i);
+    printf("\n");
+    while (!stop_requested) {
+        bool idle = true;
+        for (auto& b : boards) {
+            BoardSample s;
+            while (b->queue.pop(s)) {
+                idle = false;
+                b->fit->observe((double)s.seq, s.host_time);
+                b->history.push_back(s);
+            }
+        }
+        if (next_t == 0) {
+            // Start once every board has a fitted clock.
+            bool all_valid = true;
+            double start = 0;
+            for (auto& b : boards) {
+                if (!b->fit->valid() || b->history.empty()) { all_valid = false; break; }
+                start = std::max(start, b->fit->host_time((double)b->history.back().seq));
+            }
+            if (all_valid) next_t = std::ceil(start / grid_s) * grid_s;
+        }
+        while (next_t != 0) {
+            // Each board is ready when it has a sample at or after next_t,
+            // or when it has been silent too long.
+            bool ready = true;
+            bool late = now_s() > next_t + max_wait_s;
+            for (auto& b : boards) {
+                if (b->history.empty() ||
+                    b->fit->host_time((double)b->history.back().seq) < next_t) {
+                    if (!late) { ready = false; break; }
+                }
+            }
+            if (!ready) break;
+            char field[48];
+            snprintf(field, sizeof(field), "%.6f", next_t);
+            row = field;
+            for (auto& b : boards) {
+                std::deque<BoardSample>& h = b->history;
+                const ClockFit& fit = *b->fit;
+                // Drop samples that no longer bracket the output instant.
+                while (h.size() >= 2 && fit.host_time((double)h[1].seq) <= next_t) h.pop_front();
+                if (h.size() >= 2 && fit.host_time((double)h[0].seq) <= next_t) {
+                    double t0 = fit.host_time((double)h[0].seq);
+                    double t1 = fit.host_time((double)h[1].seq);
+                    double f = (t1 > t0) ? (next_t - t0) / (t1 - t0) : 0.0;
+                    snprintf(field, sizeof(field), ",%.2f,%.2f",
+                             interpolate_cdeg(h[0].a_cdeg, h[1].a_cdeg, f) * 0.01,
+                             interpolate_cdeg(h[0].b_cdeg, h[1].b_cdeg, f) * 0.01);
+                    row += field;
+                } else {
+                    row += ",,";
+                }
+            }
+            row += '\n';
+            fputs(row.c_str(), stdout);
+            next_t += grid_s;
+        }
+        if (idle) {
+            fflush(stdout);
+            usleep(1000);
+        }
+    }
+    for (auto& t : readers) pthread_kill(t.native_handle(), SIGINT);
+    for (auto& t : readers) t.join();
+    for (size_t i = 0; i < boards.size(); ++i) {
+        const Board& b = *boards[i];
+        fprintf(stderr, "%zu %s: %llu lines, %llu dropped; period %.6f ms, drift %.1f ppm%s\n",
+                i, b.device.c_str(), (unsigned long long)b.lines.load(),
+                (unsigned long long)b.dropped.load(), b.fit->rate() * 1e3, b.fit->drift_ppm(),
+                b.fit->valid() ? "" : " (not fitted)");
+        close(b.fd);
+    }
+    return 0;
+}
@@ -0,0 +1,310 @@
+// readout-ingest.cpp
+// Read the readout board's output from a serial device, parse it and
+// append each record, stamped with its arrival time, to a memory-mapped
+// ring file (see ring-file.h) from which other programs can read.
+//
+// Recognised lines:
+//   a_raw,b_raw,a_deg,b_deg                 samples
+//   a_raw,b_raw,a_deg,b_deg,sample_seq,record_seq   samples, deadband on
+//   Z...                                    compressed samples (delta-stream.h)
+//   T,seq,t_edge,latency,a,b                trigger records
+//   Y,n,t2,t3,seq,t_sample                  time-sync replies (time-sync.h)
+// Any other line (replies, stats, banner) is passed to the text log,
+// if one is given, and otherwise dropped.
+//
+// With -y, the board is sent a Y request every so often and, once the
+// board's clock has been fitted, samples that carry their number
+// (deadband on) and trigger records are also stamped with the host
+// time at which they were taken.
+//
+// Lines are parsed in place in the read buffer, with no copying or
+// allocation per line.  All the records in one read() share the arrival
+// time taken as that read returned.
+//
+// Build: g++ -std=c++17 -O2 -o readout-ingest readout-ingest.cpp ring-file.cpp delta-stream.cpp
+// Usage: readout-ingest [options]
+//   -d device     serial device (default /dev/ttyUSB0); a pty works too
+//   -b baud       (default 115200)
+//   -r ringfile   (default /dev/shm/readout.ring)
+//   -n slots      ring capacity, a power of 2 (default 65536)
+//   -t textfile   log of the lines that are not records
+//   -f logfile    read a saved log instead of a device, as fast as possible,
+//                 and report the parse rate
+//   -y seconds    interval of time-sync requests (default 0, none)
+//   -p period_ms  nominal sample period of the board (default 50)
+//
+// PJ, 2026-10-18
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "delta-stream.h"
+#include "readout-parse.h"
+#include "ring-file.h"
+#include "serial-port.h"
+#include "time-sync.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+static void on_signal(int) { stop_requested = 1; }
+
+static int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct Counters {
+    uint64_t bytes = 0, lines = 0, records = 0, bad_lines = 0, text_lines = 0;
+};
+
+class Ingest {
+public:
+    Ingest(RingWriter& ring, FILE* text_log, TimeSync* sync)
+        : ring_(ring), text_log_(text_log), sync_(sync)
+    {
+        samples_.reserve(256);
+    }
+
+    // Send a time-sync request.
+    void request_sync(int fd)
+    {
+        char req[24];
+        int len = snprintf(req, sizeof(req), "Y,%u\n", ++sync_id_);
+        sync_t1_ = (double)now_ns() * 1e-9;
+        sync_len_ = (unsigned)len;
+        if (write(fd, req, (size_t)len) != len) {
+            fprintf(stderr, "Write failed: %s\n", strerror(errno));
+        }
+    }
+
+    // Parse every complete line in [p, end), and return the start of
+    // the incomplete remainder.
+    const char* feed(const char* p, const char* end, int64_t host_ns)
+    {
+        for (;;) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+            if (!nl) return p;
+            const char* line_end = nl;
+            if (line_end > p && line_end[-1] == '\r') --line_end;
+            if (line_end > p) line(p, line_end, host_ns);
+            p = nl + 1;
+        }
+    }
+
+    const Counters& counters() const { return n_; }
+    const DeltaStreamDecoder& decoder() const { return decoder_; }
+
+private:
+    void line(const char* p, const char* end, int64_t host_ns)
+    {
+        ++n_.lines;
+        Record r{};
+        r.host_ns = host_ns;
+        char c = *p;
+        if (c == 'Z') {
+            samples_.clear();
+            decoder_.feed_line(p, (size_t)(end - p), samples_);
+            for (const RawSample& s : samples_) {
+                Record z{};
+                z.host_ns = host_ns;
+                z.kind = KIND_COMPRESSED_SAMPLE;
+                z.board_seq = s.seq;
+                z.a_raw = s.a;
+                z.b_raw = s.b;
+                z.flags = FLAG_HAS_SEQ;
+                ring_.push(z);
+                ++n_.records;
+            }
+            return;
+        }
+        if (c == 'T' && end - p > 2 && p[1] == ',') {
+            if (parse_trigger(p + 2, end, r)) {
+                if (sync_ && sync_->valid()) {
+                    stamp(r, sync_->host_time_of_board_us(r.board_us));
+                }
+                ring_.push(r);
+                ++n_.records;
+            } else {
+                ++n_.bad_lines;
+            }
+            return;
+        }
+        if (c == 'Y' && end - p > 2 && p[1] == ',' && sync_) {
+            sync_reply(p + 2, end, host_ns);
+        }
+        if (c == ' ' || (unsigned)(c - '0') <= 9) {
+            if (parse_sample(p, end, r)) {
+                if (sync_ && sync_->valid() && (r.flags & FLAG_HAS_SEQ)) {
+                    stamp(r, sync_->host_time_of_sample((uint16_t)r.board_seq));
+                }
+                ring_.push(r);
+                ++n_.records;
+                return;
+            }
+            // A banner line such as "a_ref = ..." or a mangled sample.
+        }
+        ++n_.text_lines;
+        if (text_log_) {
+            fwrite(p, 1, (size_t)(end - p), text_log_);
+            fputc('\n', text_log_);
+        }
+    }
+
+    static void stamp(Record& r, double host_time)
+    {
+        r.sample_ns = (int64_t)llround(host_time * 1e9);
+        r.flags |= FLAG_HAS_SAMPLE_TIME;
+    }
+
+    void sync_reply(const char* p, const char* end, int64_t host_ns)
+    {
+        Fields f{p, end};
+        uint32_t id, t2, t3, seq, t_sample;
+        if (!f.unsigned_field(id) || !f.unsigned_field(t2) || !f.unsigned_field(t3) ||
+            !f.unsigned_field(seq) || !f.unsigned_field(t_sample) || !f.at_end()) {
+            ++n_.bad_lines;
+            return;
+        }
+        // Only the reply to the latest request is timed.
+        if (id != sync_id_ || sync_len_ == 0) return;
+        unsigned reply_len = (unsigned)(end - p) + 4; // with "Y," and "\r\n"
+        sync_->exchange(sync_t1_, sync_len_, (double)host_ns * 1e-9, reply_len,
+                        t2, t3, (uint16_t)seq, t_sample);
+        sync_len_ = 0;
+    }
+
+    RingWriter& ring_;
+    FILE* text_log_;
+    TimeSync* sync_;
+    uint32_t sync_id_ = 0;
+    double sync_t1_ = 0;
+    unsigned sync_len_ = 0; // of the request awaiting its reply
+    DeltaStreamDecoder decoder_;
+    std::vector<RawSample> samples_;
+    Counters n_;
+};
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s [-d device] [-b baud] [-r ringfile] [-n slots]"
+            " [-t textfile] [-f logfile] [-y seconds] [-p period_ms]\n", prog);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string device = "/dev/ttyUSB0";
+    std::string ring_path = "/dev/shm/readout.ring";
+    std::string text_path, replay_path;
+    long baud = 115200;
+    unsigned long capacity = 65536;
+    double sync_interval_s = 0;
+    double period_s = 0.050;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:b:r:n:t:f:y:p:h")) != -1) {
+        switch (opt) {
+        case 'd': device = optarg; break;
+        case 'b': baud = strtol(optarg, nullptr, 10); break;
+        case 'r': ring_path = optarg; break;
+        case 'n': capacity = strtoul(optarg, nullptr, 10); break;
+        case 't': text_path = optarg; break;
+        case 'f': replay_path = optarg; break;
+        case 'y': sync_interval_s = atof(optarg); break;
+        case 'p': period_s = atof(optarg) * 1e-3; break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (optind != argc || period_s <= 0) { usage(argv[0]); return 1; }
+    if (!replay_path.empty()) sync_interval_s = 0;
+
+    FILE* text_log = nullptr;
+    if (!text_path.empty()) {
+        text_log = fopen(text_path.c_str(), "a");
+        if (!text_log) { fprintf(stderr, "Cannot open %s\n", text_path.c_str()); return 1; }
+        setvbuf(text_log, nullptr, _IOLBF, 0);
+    }
+    int fd;
+    if (!replay_path.empty()) {
+        fd = open(replay_path.c_str(), O_RDONLY);
+        if (fd < 0) { fprintf(stderr, "Cannot open %s\n", replay_path.c_str()); return 1; }
+    } else {
+        fd = open_serial(device.c_str(), baud, sync_interval_s > 0);
+        if (fd < 0) return 1;
+    }
+
+    try {
+        RingWriter ring(ring_path, (uint32_t)capacity);
+        TimeSync sync(10.0 / (double)baud, period_s);
+        Ingest ingest(ring, text_log, (sync_interval_s > 0) ? &sync : nullptr);
+        // Without SA_RESTART, so that a signal ends a blocked read().
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = on_signal;
+        sigaction(SIGINT, &sa, nullptr);
+        sigaction(SIGTERM, &sa, nullptr);
+
+        // The buffer holds the incomplete tail of the last read at its
+        // start.  A tail that fills it cannot be a line from the board,
+        // so it is thrown away.
+        static char buf[1 << 16];
+        size_t held = 0;
+        int64_t t_start = now_ns();
+        int64_t next_sync_ns = now_ns();
+        while (!stop_requested) {
+            if (sync_interval_s > 0) {
+                int64_t wait_ns = next_sync_ns - now_ns();
+                if (wait_ns <= 0) {
+                    ingest.request_sync(fd);
+                    next_sync_ns += (int64_t)(sync_interval_s * 1e9);
+                    continue;
+                }
+                struct pollfd pfd = {fd, POLLIN, 0};
+                if (poll(&pfd, 1, (int)(wait_ns / 1000000) + 1) <= 0) continue;
+            }
+            ssize_t got = read(fd, buf + held, sizeof(buf) - held);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                fprintf(stderr, "Read failed: %s\n", strerror(errno));
+                break;
+            }
+            if (got == 0) {
+                if (!replay_path.empty()) break;
+                // The other end of a pty went away; wait for it.
+                usleep(10000);
+                continue;
+            }
+            int64_t t = now_ns();
+            const char* end = buf + held + got;
+            const char* rest = ingest.feed(buf, end, t);
+            held = (size_t)(end - rest);
+            if (held == sizeof(buf)) { held = 0; }
+            else if (held && rest != buf) { memmove(buf, rest, held); }
+        }
+        double seconds = (double)(now_ns() - t_start) * 1e-9;
+        const Counters& n = ingest.counters();
+        fprintf(stderr, "%llu lines, %llu records, %llu text lines, %llu bad lines;"
+                " compressed: %llu lines lost, %llu samples lost\n",
+                (unsigned long long)n.lines, (unsigned long long)n.records,
+                (unsigned long long)n.text_lines, (unsigned long long)n.bad_lines,
+                (unsigned long long)ingest.decoder().lines_lost(),
+                (unsigned long long)ingest.decoder().samples_lost());
+        if (!replay_path.empty() && seconds > 0) {
+            fprintf(stderr, "Parsed %.1f Mlines/s\n", (double)n.lines / seconds * 1e-6);
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    close(fd);
+    if (text_log) fclose(text_log);
+    return 0;
+}
@@ -0,0 +1,103 @@
+// readout-parse.h
+// In-place parsers for the board's sample and trigger lines.
+// PJ, 2026-10-18
+
+#ifndef READOUT_PARSE_H
+#define READOUT_PARSE_H
+
+#include <cstdint>
+#include "ring-file.h"
+
+// Field scanner over [p, end).  Each function consumes one field and the
+// comma after it, and returns false if the field is malformed.
+struct Fields {
+    const char* p;
+    const char* end;
+
+    void skip_spaces() { while (p < end && *p == ' ') ++p; }
+    bool separator()
+    {
+        if (p == end) return true;
+        if (*p != ',') return false;
+        ++p;
+        return true;
+    }
+    bool at_end() const { return p == end; }
+
+    bool unsigned_field(uint32_t& v)
+    {
+        skip_spaces();
+        if (p == end || (unsigned)(*p - '0') > 9) return false;
+        uint32_t x = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9) { x = x * 10 + (uint32_t)(*p++ - '0'); }
+        v = x;
+        return separator();
+    }
+
+    // Fixed-point degrees as written by values_to_string_buffer(),
+    // for example " -12.34", returned in 1/100 degree.
+    bool centidegree_field(int32_t& v)
+    {
+        skip_spaces();
+        bool negative = false;
+        if (p < end && *p == '-') { negative = true; ++p; }
+        int32_t x = 0;
+        int ndigits = 0;
+        while (p < end && (unsigned)(*p - '0') <= 9) { x = x * 10 + (*p++ - '0'); ++ndigits; }
+        if (p == end || *p != '.' || ndigits == 0) return false;
+        ++p;
+        for (int i = 0; i < 2; ++i) {
+            if (p == end || (unsigned)(*p - '0') > 9) return false;
+            x = x * 10 + (*p++ - '0');
+        }
+        v = negative ? -x : x;
+        return separator();
+    }
+};
+
+inline bool parse_sample(const char* p, const char* end, Record& r)
+{
+    Fields f{p, end};
+    uint32_t a, b;
+    if (!f.unsigned_field(a) || !f.unsigned_field(b) ||
+        !f.centidegree_field(r.a_cdeg) || !f.centidegree_field(r.b_cdeg)) {
+        return false;
+    }
+    if (a > 0xffff || b > 0xffff) return false;
+    r.kind = KIND_SAMPLE;
+    r.a_raw = (uint16_t)a;
+    r.b_raw = (uint16_t)b;
+    r.flags = FLAG_HAS_DEGREES;
+    if (!f.at_end()) {
+        uint32_t sample_seq, record_seq;
+        if (!f.unsigned_field(sample_seq) || !f.unsigned_field(record_seq) || !f.at_end()) {
+            return false;
+        }
+        r.board_seq = sample_seq;
+        r.record_seq = record_seq;
+        r.flags |= FLAG_HAS_SEQ;
+    }
+    return true;
+}
+
+inline bool parse_trigger(const char* p, const char* end, Record& r)
+{
+    // p points after "T,".
+    Fields f{p, end};
+    uint32_t seq, t_edge, latency, a, b;
+    if (!f.unsigned_field(seq) || !f.unsigned_field(t_edge) ||
+        !f.unsigned_field(latency) || !f.unsigned_field(a) ||
+        !f.unsigned_field(b) || !f.at_end()) {
+        return false;
+    }
+    r.kind = KIND_TRIGGER;
+    r.board_seq = seq;
+    r.board_us = t_edge;
+    r.latency_us = (uint16_t)(latency > 0xffff ? 0xffff : latency);
+    r.a_raw = (uint16_t)a;
+    r.b_raw = (uint16_t)b;
+    r.flags = FLAG_HAS_SEQ | FLAG_HAS_BOARD_TIME;
+    return true;
+}
+
+#endif
@@ -0,0 +1,98 @@
+// ring-file.cpp
+// PJ, 2026-10-18
+
+#include "ring-file.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+RingWriter::RingWriter(const std::string& path, uint32_t capacity)
+{
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        throw std::invalid_argument("ring capacity must be a power of 2");
+    }
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("cannot create " + path);
+    size_ = ring_file_size(capacity);
+    if (ftruncate(fd, (off_t)size_) != 0) {
+        close(fd);
+        throw std::runtime_error("cannot size " + path);
+    }
+    void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+    hdr_ = static_cast<RingHeader*>(p);
+    // The file is freshly zeroed, so the atomics start at 0.
+    hdr_->slot_size = sizeof(Slot);
+    hdr_->capacity = capacity;
+    mask_ = capacity - 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    // Readers check the magic last.
+    memcpy(hdr_->magic, RING_MAGIC, sizeof(RING_MAGIC));
+}
+
+RingWriter::~RingWriter()
+{
+    if (hdr_) munmap(hdr_, size_);
+}
+
+RingReader::RingReader(const std::string& path, bool from_now)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < ring_file_size(1)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a ring file");
+    }
+    size_ = (size_t)st.st_size;
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+    hdr_ = static_cast<const RingHeader*>(p);
+    if (memcmp(hdr_->magic, RING_MAGIC, sizeof(RING_MAGIC)) != 0 ||
+        hdr_->slot_size != sizeof(Slot) ||
+        ring_file_size(hdr_->capacity) > size_) {
+        munmap(const_cast<RingHeader*>(hdr_), size_);
+        throw std::runtime_error(path + " is not a ring file of this version");
+    }
+    mask_ = hdr_->capacity - 1;
+    uint64_t w = hdr_->written.load(std::memory_order_acquire);
+    next_ = (from_now || w < hdr_->capacity) ? (from_now ? w : 0) : w - hdr_->capacity;
+}
+
+RingReader::~RingReader()
+{
+    if (hdr_) munmap(const_cast<RingHeader*>(hdr_), size_);
+}
+
+RingReader::Result RingReader::next(Record& out)
+{
+    uint64_t w = hdr_->written.load(std::memory_order_acquire);
+    if (next_ >= w) return EMPTY;
+    if (w - next_ > hdr_->capacity) {
+        uint64_t oldest = w - hdr_->capacity;
+        skipped_ += oldest - next_;
+        next_ = oldest;
+        return OVERRUN;
+    }
+    const Slot& s = hdr_->slots[next_ & mask_];
+    if (s.tag.load(std::memory_order_acquire) != next_ + 1) {
+        // The writer has lapped us while we looked.
+        ++skipped_;
+        ++next_;
+        return OVERRUN;
+    }
+    out = s.rec;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.tag.load(std::memory_order_relaxed) != next_ + 1) {
+        ++skipped_;
+        ++next_;
+        return OVERRUN;
+    }
+    ++next_;
+    return OK;
+}
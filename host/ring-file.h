@@ -0,0 +1,121 @@
+// ring-file.h
+// A memory-mapped ring of fixed-size records, written by one process
+// (readout-ingest) and read, without locks, by any number of others.
+//
+// Each slot carries the number of the record that it holds (plus one),
+// written last by the writer and checked before and after copying by
+// a reader, in the manner of a sequence lock.  A reader that falls more
+// than a ring's length behind sees that its records have been
+// overwritten and can skip ahead.
+//
+// PJ, 2026-10-18
+
+#ifndef RING_FILE_H
+#define RING_FILE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+enum RecordKind : uint8_t {
+    KIND_SAMPLE = 1, // text sample line
+    KIND_COMPRESSED_SAMPLE = 2, // sample reconstructed from Z lines
+    KIND_TRIGGER = 3, // T line, encoders latched by the trigger input
+};
+
+// Flags
+const uint8_t FLAG_HAS_DEGREES = 0x01; // a_cdeg and b_cdeg are valid
+const uint8_t FLAG_HAS_SEQ = 0x02; // board_seq is valid
+const uint8_t FLAG_HAS_BOARD_TIME = 0x04; // board_us is valid
+const uint8_t FLAG_HAS_SAMPLE_TIME = 0x08; // sample_ns is valid
+
+struct Record {
+    int64_t host_ns; // CLOCK_REALTIME at arrival
+    int64_t sample_ns; // when the sample was taken, in host time (time-sync.h)
+    uint32_t board_seq; // sample number counted by the board
+    uint32_t board_us; // board timestamp (for trigger records, the edge)
+    int32_t a_cdeg, b_cdeg; // signed 1/100 degree, relative to reference
+    uint16_t a_raw, b_raw;
+    uint16_t latency_us; // trigger edge to latch
+    uint8_t kind;
+    uint8_t flags;
+    uint32_t record_seq; // record number, deadband on
+    uint32_t reserved;
+};
+static_assert(sizeof(Record) == 48, "Record layout is part of the file format");
+
+struct Slot {
+    std::atomic<uint64_t> tag; // record number + 1, or 0 while being written
+    Record rec;
+};
+
+struct RingHeader {
+    char magic[8]; // "RDRING2\0"
+    uint32_t slot_size;
+    uint32_t capacity; // number of slots, a power of 2
+    alignas(64) std::atomic<uint64_t> written; // records committed so far
+    alignas(64) Slot slots[1];
+};
+
+const char RING_MAGIC[8] = {'R', 'D', 'R', 'I', 'N', 'G', '2', 0};
+
+inline size_t ring_file_size(uint32_t capacity)
+{
+    return offsetof(RingHeader, slots) + sizeof(Slot) * (size_t)capacity;
+}
+
+class RingWriter {
+public:
+    // Creates (or truncates) the file and maps it.  Throws on failure.
+    RingWriter(const std::string& path, uint32_t capacity);
+    ~RingWriter();
+    RingWriter(const RingWriter&) = delete;
+    RingWriter& operator=(const RingWriter&) = delete;
+
+    void push(const Record& r)
+    {
+        uint64_t n = next_;
+        Slot& s = hdr_->slots[n & mask_];
+        s.tag.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.rec = r;
+        s.tag.store(n + 1, std::memory_order_release);
+        next_ = n + 1;
+        hdr_->written.store(next_, std::memory_order_release);
+    }
+    uint64_t written() const { return next_; }
+
+private:
+    RingHeader* hdr_ = nullptr;
+    size_t size_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t next_ = 0;
+};
+
+class RingReader {
+public:
+    // Maps an existing ring file read-only.  Throws on failure.
+    // The reader starts at the oldest record still held, or with
+    // from_now set, at the next record to be written.
+    explicit RingReader(const std::string& path, bool from_now = false);
+    ~RingReader();
+    RingReader(const RingReader&) = delete;
+    RingReader& operator=(const RingReader&) = delete;
+
+    enum Result { OK, EMPTY, OVERRUN };
+    // On OVERRUN the reader has skipped ahead; call again.
+    Result next(Record& out);
+    uint64_t position() const { return next_; }
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    const RingHeader* hdr_ = nullptr;
+    size_t size_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t next_ = 0;
+    uint64_t skipped_ = 0;
+};
+
+#endif
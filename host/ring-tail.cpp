@@ -0,0 +1,55 @@
+// ring-tail.cpp
+// Print the records from a ring file written by readout-ingest,
+// as comma-separated values, following the ring as it grows.
+// Any number of these may run at once; none of them slows the writer.
+//
+// Build: g++ -std=c++17 -O2 -o ring-tail ring-tail.cpp ring-file.cpp
+// Usage: ring-tail [-a] [ringfile]
+//   -a  start at the oldest record held, rather than at the newest
+//
+// PJ, 2026-10-18
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include "ring-file.h"
+
+int main(int argc, char* argv[])
+{
+    bool from_oldest = false;
+    std::string path = "/dev/shm/readout.ring";
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-a") == 0) { from_oldest = true; }
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "Usage: %s [-a] [ringfile]\n", argv[0]);
+            return 1;
+        } else { path = argv[i]; }
+    }
+    try {
+        RingReader reader(path, !from_oldest);
+        printf("host_ns,sample_ns,kind,board_seq,board_us,a_raw,b_raw,a_cdeg,b_cdeg,latency_us\n");
+        Record r;
+        for (;;) {
+            switch (reader.next(r)) {
+            case RingReader::OK:
+                printf("%lld,%lld,%u,%u,%u,%u,%u,%d,%d,%u\n", (long long)r.host_ns,
+                       (long long)r.sample_ns, r.kind,
+                       r.board_seq, r.board_us, r.a_raw, r.b_raw, r.a_cdeg, r.b_cdeg,
+                       r.latency_us);
+                break;
+            case RingReader::OVERRUN:
+                fprintf(stderr, "Fell behind, %llu records skipped so far\n",
+                        (unsigned long long)reader.skipped());
+                break;
+            case RingReader::EMPTY:
+                fflush(stdout);
+                usleep(1000);
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
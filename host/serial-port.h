@@ -0,0 +1,62 @@
+// serial-port.h
+// Open the board's serial port, raw, with RTS/CTS.
+// PJ, 2026-10-18
+
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+inline bool baud_to_speed(long baud, speed_t& speed)
+{
+    switch (baud) {
+    case 9600: speed = B9600; return true;
+    case 19200: speed = B19200; return true;
+    case 38400: speed = B38400; return true;
+    case 57600: speed = B57600; return true;
+    case 115200: speed = B115200; return true;
+    case 230400: speed = B230400; return true;
+    case 460800: speed = B460800; return true;
+    case 500000: speed = B500000; return true;
+    case 921600: speed = B921600; return true;
+    case 1000000: speed = B1000000; return true;
+    case 2000000: speed = B2000000; return true;
+    default: return false;
+    }
+}
+
+inline int open_serial(const char* device, long baud, bool for_writing = false)
+{
+    speed_t speed;
+    if (!baud_to_speed(baud, speed)) {
+        fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+        return -1;
+    }
+    int fd = open(device, (for_writing ? O_RDWR : O_RDONLY) | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", device, strerror(errno));
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD | CRTSCTS;
+        // Return as soon as anything arrives, so the arrival time is close.
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+            fprintf(stderr, "Cannot configure %s: %s\n", device, strerror(errno));
+        }
+    }
+    tcflush(fd, TCIFLUSH);
+    return fd;
+}
+
+#endif
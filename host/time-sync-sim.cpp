@@ -0,0 +1,152 @@
+// time-sync-sim.cpp
+// Host-side simulation of the Y time-sync exchange (see time-sync.h),
+// to check the estimator against a board whose clock is known.
+//
+// The simulated board clock has an offset and a drift that wanders
+// slowly.  Each exchange sees the transmission time of its two lines,
+// USB latency in each direction (up to one frame, 1ms for a full-speed
+// adapter or 125us for high speed, plus a random tail and occasional
+// long stalls), and a wait of up to one cycle before
+// the main loop answers.  After a settling time, the estimated host
+// time of board events and of samples is compared with the truth.
+//
+// Build: g++ -std=c++17 -O2 -o time-sync-sim time-sync-sim.cpp
+// Usage: time-sync-sim [--baud b] [--period-ms ms] [--interval-s s]
+//                      [--minutes m] [--drift-ppm p] [--usb-frame-us us]
+//                      [--seed s]
+//
+// PJ, 2026-10-18
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "time-sync.h"
+
+struct Board {
+    double t0; // host time at which the board clock read offset_us
+    double offset_us;
+    double drift; // fractional
+    double wander; // fractional drift change per second (random walk)
+    double period_s; // nominal sample period, in board time
+
+    double rate_at(double t) const { return 1.0 + drift + wander * (t - t0); }
+    // Board microseconds at host time t, with the drift's random walk
+    // approximated by a linear change over the run.
+    double us_at(double t) const
+    {
+        double dt = t - t0;
+        return offset_us + 1e6 * (dt * (1.0 + drift) + 0.5 * wander * dt * dt);
+    }
+    double host_time_of_us(double us) const
+    {
+        // Invert us_at() by Newton's method.
+        double t = t0 + (us - offset_us) * 1e-6;
+        for (int i = 0; i < 4; ++i) { t -= (us_at(t) - us) / (1e6 * rate_at(t)); }
+        return t;
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    long baud = 115200;
+    double period_ms = 50.0;
+    double interval_s = 1.0;
+    double minutes = 30.0;
+    double drift_ppm = 40.0;
+    double usb_frame_us = 1000.0;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { fprintf(stderr, "Missing value for %s\n", arg.c_str()); exit(1); }
+            return argv[++i];
+        };
+        if (arg == "--baud") { baud = atol(next()); }
+        else if (arg == "--period-ms") { period_ms = atof(next()); }
+        else if (arg == "--interval-s") { interval_s = atof(next()); }
+        else if (arg == "--minutes") { minutes = atof(next()); }
+        else if (arg == "--drift-ppm") { drift_ppm = atof(next()); }
+        else if (arg == "--usb-frame-us") { usb_frame_us = atof(next()); }
+        else if (arg == "--seed") { seed = (unsigned)atol(next()); }
+        else {
+            fprintf(stderr, "Usage: %s [--baud b] [--period-ms ms] [--interval-s s]"
+                    " [--minutes m] [--drift-ppm p] [--usb-frame-us us] [--seed s]\n", argv[0]);
+            return 1;
+        }
+    }
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> tail(1.0);
+    double char_s = 10.0 / baud;
+    double period_s = period_ms * 1e-3;
+    double t_start = 1.7e9; // host time, as from CLOCK_REALTIME
+    Board board{t_start, 3.0e9, drift_ppm * 1e-6, 0.002e-6 * (uniform(rng) - 0.5), period_s};
+    double duration = minutes * 60.0;
+    double settle = std::min(120.0, 0.25 * duration);
+
+    auto usb_latency = [&]() {
+        double d = 1e-6 * usb_frame_us * (uniform(rng) + 0.2 * tail(rng));
+        if (uniform(rng) < 0.01) d += 5e-3 + 15e-3 * uniform(rng); // stall
+        return d;
+    };
+    // The board's samples are taken at the start of each cycle,
+    // which is timed by the board's own clock.
+    auto sample_us = [&](int64_t k) { return board.offset_us + (double)k * period_s * 1e6 + 20.0; };
+
+    TimeSync sync(char_s, period_s);
+    std::vector<double> err_us, sample_err_us;
+    uint32_t n = 0;
+    for (double t1 = t_start + 0.1; t1 < t_start + duration; t1 += interval_s) {
+        char request[32], reply[80];
+        int request_len = snprintf(request, sizeof(request), "Y,%u\n", n);
+        double t_rx = t1 + request_len * char_s + usb_latency();
+        double b2 = board.us_at(t_rx);
+        // The main loop picks up the command at its next cycle boundary,
+        // after taking that cycle's sample.
+        int64_t k = (int64_t)std::ceil((b2 - sample_us(0)) / (period_s * 1e6));
+        double b_sample = sample_us(k);
+        double b3 = b_sample + 2000.0 + 500.0 * uniform(rng); // sampling and other work
+        double t_tx = board.host_time_of_us(b3);
+        int reply_len = snprintf(reply, sizeof(reply), "Y,%u,%lu,%lu,%u,%lu\r\n", n,
+                                 (unsigned long)(uint32_t)b2, (unsigned long)(uint32_t)b3,
+                                 (unsigned)(uint16_t)k, (unsigned long)(uint32_t)b_sample);
+        double t4 = t_tx + reply_len * char_s + usb_latency();
+        sync.exchange(t1, (unsigned)request_len, t4, (unsigned)reply_len,
+                      (uint32_t)b2, (uint32_t)b3, (uint16_t)k, (uint32_t)b_sample);
+        ++n;
+        if (t1 - t_start < settle || !sync.valid()) continue;
+        // Check a board event at a random time before the next exchange,
+        // and the sample nearest to it.
+        double t_event = t1 + interval_s * uniform(rng);
+        double b_event = board.us_at(t_event);
+        err_us.push_back(1e6 * (sync.host_time_of_board_us((uint32_t)b_event) - t_event));
+        int64_t ks = (int64_t)std::floor((b_event - sample_us(0)) / (period_s * 1e6));
+        double t_sample = board.host_time_of_us(sample_us(ks));
+        sample_err_us.push_back(1e6 * (sync.host_time_of_sample((uint16_t)ks) - t_sample));
+    }
+    if (err_us.empty()) {
+        fprintf(stderr, "No estimates; run for longer.\n");
+        return 1;
+    }
+    auto report = [](const char* what, std::vector<double>& e) {
+        double sum = 0, sum2 = 0;
+        for (double x : e) { sum += x; sum2 += x * x; }
+        std::sort(e.begin(), e.end(), [](double a, double b) { return std::fabs(a) < std::fabs(b); });
+        printf("%s error (us): mean %.2f rms %.2f |p99| %.2f |max| %.2f\n", what,
+               sum / e.size(), std::sqrt(sum2 / e.size()),
+               std::fabs(e[(size_t)(0.99 * (e.size() - 1))]), std::fabs(e.back()));
+    };
+    printf("Baud %ld, cycle %.1f ms, exchange every %.1f s for %.0f min, drift %.1f ppm,"
+           " USB frame %.0f us\n", baud, period_ms, interval_s, minutes, drift_ppm, usb_frame_us);
+    printf("Estimated drift %.3f ppm, sample period %.6f ms\n",
+           sync.drift_ppm(), sync.sample_period_s() * 1e3);
+    report("Board time to host time", err_us);
+    report("Sample to host time    ", sample_err_us);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// time-sync.h
+// Relate the board's microsecond clock (timestamp.c) to the host's
+// clock from Y exchanges:
+//   host writes   Y,n\n                                at t1 (host time)
+//   board replies Y,n,t2,t3,seq,t_sample\r\n           received at t4
+// where t2 is the board's time at the end of the request line, t3 its
+// time as it starts the reply, and seq and t_sample the number and time
+// of its latest sample.
+//
+// As in NTP, the midpoint of the exchange, with the board's time spent
+// between t2 and t3 taken out, puts a point on the line relating the
+// two clocks.  The transmission time of each line is removed first, so
+// that the remaining delays (USB and driver) are close to symmetric.
+// The exchange with the shortest round trip in each block is fitted
+// (clock-fit.h), which follows the drift of the board's oscillator.
+//
+// A second fit, from the sample numbers to board time, lets any sample
+// that carries its number be stamped with host time.
+//
+// PJ, 2026-10-18
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <cstdint>
+#include "clock-fit.h"
+
+class TimeSync {
+public:
+    // char_time_s: time to send one character (10 bits) at the baud rate.
+    // sample_period_s: nominal sample period of the board.
+    // block: exchanges of which the shortest is used.
+    TimeSync(double char_time_s, double sample_period_s, unsigned block = 4)
+        : char_time_(char_time_s), block_(block ? block : 1),
+          clock_(1e-6, 1, 0.98), samples_(sample_period_s * 1e6, 1, 0.99) {}
+
+    // t1 and t4 in host seconds; the lengths include line ends.
+    void exchange(double t1, unsigned request_len, double t4, unsigned reply_len,
+                  uint32_t t2, uint32_t t3, uint16_t seq, uint32_t t_sample)
+    {
+        double b2 = (double)unwrap_us(t2);
+        double b3 = (double)unwrap_us(t3);
+        double sent = t1 + request_len * char_time_; // as the board stamps t2
+        double received = t4 - reply_len * char_time_; // as the board stamped t3
+        double board_s = (b3 - b2) * clock_.rate();
+        double delay = (received - sent) - board_s;
+        last_delay_ = delay;
+        if (n_block_ == 0 || delay < best_delay_) {
+            best_delay_ = delay;
+            best_board_ = 0.5 * (b2 + b3);
+            best_host_ = 0.5 * (sent + received);
+        }
+        if (++n_block_ >= block_) {
+            clock_.add_point(best_board_, best_host_);
+            n_block_ = 0;
+        }
+        samples_.add_point((double)unwrap_seq(seq), (double)unwrap_us(t_sample));
+        ++exchanges_;
+    }
+
+    bool valid() const { return clock_.valid() && samples_.valid(); }
+    // Host time of a board timestamp taken within half an hour of the
+    // latest exchange.
+    double host_time_of_board_us(uint32_t us) const
+    {
+        int64_t ext = last_us_ + (int32_t)(us - (uint32_t)last_us_);
+        return clock_.host_time((double)ext);
+    }
+    // Host time of a sample, from its number, within 32768 samples of
+    // the latest exchange.
+    double host_time_of_sample(uint16_t seq) const
+    {
+        int64_t ext = last_seq_ + (int16_t)(seq - (uint16_t)last_seq_);
+        return clock_.host_time(samples_.host_time((double)ext));
+    }
+    // How fast the board's clock runs, in parts per million.
+    double drift_ppm() const { return (1e-6 / clock_.rate() - 1.0) * 1e6; }
+    double sample_period_s() const { return samples_.rate() * 1e-6; }
+    double last_delay() const { return last_delay_; }
+    uint64_t exchanges() const { return exchanges_; }
+
+private:
+    int64_t unwrap_us(uint32_t us)
+    {
+        if (!have_us_) { have_us_ = true; last_us_ = us; }
+        else { last_us_ += (int32_t)(us - (uint32_t)last_us_); }
+        return last_us_;
+    }
+    int64_t unwrap_seq(uint16_t seq)
+    {
+        if (!have_seq_) { have_seq_ = true; last_seq_ = seq; }
+        else { last_seq_ += (int16_t)(seq - (uint16_t)last_seq_); }
+        return last_seq_;
+    }
+
+    double char_time_;
+    unsigned block_;
+    ClockFit clock_; // board us to host seconds
+    ClockFit samples_; // sample number to board us
+    unsigned n_block_ = 0;
+    double best_delay_ = 0, best_board_ = 0, best_host_ = 0;
+    double last_delay_ = 0;
+    bool have_us_ = false, have_seq_ = false;
+    int64_t last_us_ = 0, last_seq_ = 0;
+    uint64_t exchanges_ = 0;
+};
+
+#endif
@@ -0,0 +1,170 @@
+// trigger-latency-sim.cpp
+// Host-side simulation of the edge-to-latch latency of the trigger input
+// (see trigger.c in the firmware).
+//
+// The firmware's main loop holds off interrupts while it clocks an SSI
+// frame, so an edge that arrives during that window waits for the frame
+// to finish before the CCP1 interrupt can latch the encoders.
+// The other places that hold off interrupts are also modelled:
+//   - each frame of a burst capture (--burst n frames, capture.c),
+//   - the unlock sequence of each EEPROM write (--eeprom n bytes);
+//     the write itself, about 4ms, runs with interrupts on (eeprom.c),
+//   - the short reads in timestamp_now() and the like,
+//   - the other handlers in the interrupt service routine, which may
+//     run ahead of the trigger's when their flags are also set.
+// We model one cycle of the main loop as a set of windows in which
+// interrupts are masked, throw edges at it uniformly in time and
+// accumulate the latency that the firmware would see and report.
+// Times are counted in instruction cycles (FOSC/4), as on the MCU.
+//
+// Build: g++ -std=c++17 -O2 -o trigger-latency-sim trigger-latency-sim.cpp
+// Usage: trigger-latency-sim [--fosc Hz] [--encoder aeat12|aeat10|as36|mixed]
+//                            [--period-ms ms] [--burst n] [--eeprom n]
+//                            [--edges n] [--seed s]
+//
+// PJ, 2026-10-18
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Window {
+    double start_us;
+    double length_us;
+    const char* what;
+};
+
+// Instruction-cycle estimates for the compiled firmware (XC8, PIC18).
+// These are approximate and should be checked against the listing
+// or an oscilloscope if the code changes much.
+const int ISR_ENTRY_CYCLES = 3; // hardware vectoring
+const int ISR_CONTEXT_CYCLES = 40; // context save by the compiler
+const int ISR_PRELATCH_CYCLES = 60; // flag checks, capture read, timestamp_now()
+const int SSI_BIT_OVERHEAD_CYCLES = 12; // shifts and port reads per bit
+const int OTHER_HANDLERS_CYCLES = 160; // Timer1, Timer2, UART, quad-out, quad-in, AS5600 PWM
+const int EEPROM_UNLOCK_CYCLES = 12; // GIE off to WR set, in DATAEE_WriteByte()
+const int BURST_GAP_CYCLES = 120; // capture_store() between burst frames
+
+double ssi_frame_us(const std::string& encoder, double tcy_us)
+{
+    // Mirrors read_AEAT_encoders(), read_AS36_encoders() and
+    // read_mixed_encoders(), whose frame is as long as the AS36's.
+    if (encoder == "as36" || encoder == "mixed") {
+        return 1.0 + 16 * (2.0 + SSI_BIT_OVERHEAD_CYCLES * tcy_us) + 1.0 + 16.0;
+    }
+    int nbits = (encoder == "aeat10") ? 10 : 12;
+    return 1.0 + nbits * (2.0 + SSI_BIT_OVERHEAD_CYCLES * tcy_us) + 1.0;
+}
+
+double latch_offset_us(const std::string& encoder, double tcy_us)
+{
+    // Time from entering the read function to the encoders latching.
+    // AEAT latches on CSn falling; AS36 on the first CLK falling edge.
+    (void)encoder;
+    return 4 * tcy_us;
+}
+
+int main(int argc, char* argv[])
+{
+    double fosc = 32.0e6;
+    std::string encoder = "aeat12";
+    double period_ms = 50.0;
+    int burst = 0;
+    int eeprom_bytes = 0;
+    long n_edges = 1000000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* {
+            if (i + 1 >= argc) { fprintf(stderr, "Missing value for %s\n", arg.c_str()); exit(1); }
+            return argv[++i];
+        };
+        if (arg == "--fosc") { fosc = atof(next()); }
+        else if (arg == "--encoder") { encoder = next(); }
+        else if (arg == "--period-ms") { period_ms = atof(next()); }
+        else if (arg == "--burst") { burst = atoi(next()); }
+        else if (arg == "--eeprom") { eeprom_bytes = atoi(next()); }
+        else if (arg == "--edges") { n_edges = atol(next()); }
+        else if (arg == "--seed") { seed = (unsigned)atol(next()); }
+        else {
+            fprintf(stderr, "Usage: %s [--fosc Hz] [--encoder aeat12|aeat10|as36|mixed]"
+                    " [--period-ms ms] [--burst n] [--eeprom n] [--edges n] [--seed s]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (encoder != "aeat12" && encoder != "aeat10" && encoder != "as36" && encoder != "mixed") {
+        fprintf(stderr, "Unknown encoder type: %s\n", encoder.c_str());
+        return 1;
+    }
+    double tcy_us = 4.0e6 / fosc;
+    double period_us = period_ms * 1000.0;
+    double frame_us = ssi_frame_us(encoder, tcy_us);
+    // The main loop masks interrupts for each frame of a burst capture,
+    // for its own SSI frame, briefly in each call to timestamp_now()
+    // and for the unlock sequence of each EEPROM byte written.
+    std::vector<Window> masked;
+    double t = 0.0;
+    for (int k = 0; k < burst; ++k) {
+        masked.push_back({t, frame_us, "burst-capture SSI frame"});
+        t += frame_us + BURST_GAP_CYCLES * tcy_us;
+    }
+    masked.push_back({t, frame_us, "main-loop SSI frame"});
+    t += frame_us + 200.0;
+    masked.push_back({t, 20 * tcy_us, "timestamp_now()"});
+    t += 1000.0;
+    for (int k = 0; k < eeprom_bytes; ++k) {
+        masked.push_back({t, EEPROM_UNLOCK_CYCLES * tcy_us, "EEPROM write unlock"});
+        t += 4000.0; // The next byte follows once the write is done.
+    }
+    if (t > period_us) {
+        fprintf(stderr, "The masked windows do not fit in one cycle.\n");
+        return 1;
+    }
+    double longest_us = 0.0;
+    for (const auto& w : masked) { longest_us = std::max(longest_us, w.length_us); }
+    double isr_us = (ISR_ENTRY_CYCLES + ISR_CONTEXT_CYCLES + ISR_PRELATCH_CYCLES) * tcy_us
+        + latch_offset_us(encoder, tcy_us);
+    double others_us = OTHER_HANDLERS_CYCLES * tcy_us;
+    //
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> when(0.0, period_us);
+    std::vector<double> latency;
+    std::vector<long> reported; // as the firmware sees it, in whole 1us ticks
+    latency.reserve(n_edges);
+    reported.reserve(n_edges);
+    for (long i = 0; i < n_edges; ++i) {
+        double t_edge = when(rng);
+        double t_start = t_edge;
+        for (const auto& w : masked) {
+            if (t_start >= w.start_us && t_start < w.start_us + w.length_us) {
+                t_start = w.start_us + w.length_us;
+            }
+        }
+        // Other handlers run ahead of the trigger's only now and then;
+        // we take them as equally likely to cost anything up to their worst.
+        double t_latch = t_start + isr_us + others_us * std::generate_canonical<double, 53>(rng);
+        latency.push_back(t_latch - t_edge);
+        reported.push_back((long)std::floor(t_latch) - (long)std::floor(t_edge));
+    }
+    std::sort(latency.begin(), latency.end());
+    auto pct = [&](double p) { return latency[(size_t)(p * (latency.size() - 1))]; };
+    double sum = 0.0;
+    for (double x : latency) { sum += x; }
+    long rmax = *std::max_element(reported.begin(), reported.end());
+    //
+    printf("Encoder %s, FOSC %.0f Hz, cycle %.1f ms, %ld edges\n", encoder.c_str(), fosc, period_ms, n_edges);
+    printf("SSI frame with interrupts held off: %.2f us\n", frame_us);
+    printf("Longest stretch with interrupts held off: %.2f us\n", longest_us);
+    printf("Interrupt entry to latch: %.2f us, plus up to %.2f us of other handlers\n", isr_us, others_us);
+    printf("Edge-to-latch latency (us): min %.2f mean %.3f p50 %.2f p99 %.2f p99.99 %.2f max %.2f\n",
+           latency.front(), sum / latency.size(), pct(0.5), pct(0.99), pct(0.9999), latency.back());
+    printf("Bound (longest masked + other handlers + entry to latch): %.2f us;"
+           " largest reported latency: %ld us\n", longest_us + others_us + isr_us, rmax);
+    return 0;
+}
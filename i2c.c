@@ -5,30 +5,68 @@
 // PJ, 2019-03-11
 // Adapted to the PIC18F26Q10-I/SP MCU, mostly by changing the assigned pins.
 // PJ, 2023-03-03
+// Clock setting derived from FOSC.
+// Register read with a repeated start, as one transaction.
+// Recovery of a stuck bus, and back-off from devices that fail.
+// PJ, 2026-10-18
+//
+// After any failed transaction the bus is checked before the next one.
+// If a slave is holding SDA low (it was part way through sending a
+// byte when the master gave up), SCL is clocked by hand until SDA is
+// released, at most 9 pulses, and a STOP is made before the MSSP is
+// enabled again.  This takes about 0.1ms, or at most about 1ms
+// if a slave is also holding SCL low.
+// A device that keeps failing, such as an unplugged LCD, is skipped for
+// 1, 3, 7, ... up to 127 of its following transactions, and the bus as
+// a whole is skipped in the same way while recovery does not free it,
+// so that a dead device costs next to nothing until it comes back.
 
 #include <xc.h>
 #include <stdint.h>
 #include "global_defs.h"
+#include "clock.h"
+#include "i2c.h"
 
 static uint8_t i2c1_error = 0; // Will be set if there is a timeout event.
 uint8_t i2c1_get_error_flag(void) { return i2c1_error; }
 
-void i2c1_init(void)
+// Back-off state for the bus and for each device address seen.
+static uint8_t suspect = 0; // Check the bus before the next transaction.
+static uint8_t bus_level = 0, bus_skip = 0;
+static uint8_t dev_addr[I2C1_N_DEVICES];
+static uint8_t dev_level[I2C1_N_DEVICES];
+static uint8_t dev_skip[I2C1_N_DEVICES];
+static uint8_t n_devices = 0;
+static uint16_t recoveries = 0;
+uint16_t i2c1_get_recoveries(void) { return recoveries; }
+
+#define SCL_PIN PORTCbits.RC3
+#define SDA_PIN PORTCbits.RC4
+
+static void connect_pins(uint8_t to_mssp)
 {
     // Default pin mapping for PIC18F26Q10-I/SP
     // SCL1 RC3
     // SDA1 RC4
+    // Otherwise the pins are driven from LATC, for bus recovery.
+    uint8_t GIEBitValue = INTCONbits.GIE;
     GIE = 0;
     PPSLOCK = 0x55;
     PPSLOCK = 0xaa;
     PPSLOCKED = 0;
     SSP1CLKPPS = 0b10011; // RC3
-    RC3PPS = 0x0f; // MSSP1 SCL
+    RC3PPS = (to_mssp) ? 0x0f : 0x00; // MSSP1 SCL
     SSP1DATPPS = 0b10100; // RC4
-    RC4PPS = 0x10; // MSSP1 SDA
+    RC4PPS = (to_mssp) ? 0x10 : 0x00; // MSSP1 SDA
     PPSLOCK = 0x55;
     PPSLOCK = 0xaa;
     PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+}
+
+void i2c1_init(void)
+{
+    connect_pins(1);
     ANSELCbits.ANSELC3 = 0; // allow digital input
     ANSELCbits.ANSELC4 = 0;
     TRISCbits.TRISC3 = 1; // Set to input, as per data sheet instructions.
@@ -36,11 +74,14 @@ void i2c1_init(void)
     // Configure module
     SSP1STATbits.SMP = 1; // Disable slew-rate control for 100kHz
     SSP1CON1bits.SSPM = 0b1000; // master mode, clock=FOSC/(4*(SSP1ADD+1))
-    SSP1ADD = 0x4f; // To get 100 kHz I2C clock when FOSC=32MHz
+    SSP1ADD = I2C1_SSPADD; // To get 100 kHz I2C clock, 0x4f when FOSC=32MHz
     SSP1CON1bits.SSPEN = 1; // Enable module.
     PIR3bits.SSP1IF = 0;
     PIR3bits.BCL1IF = 0;
     i2c1_error = 0;
+    suspect = 0;
+    bus_level = 0; bus_skip = 0;
+    n_devices = 0;
     return;
 }
 
@@ -50,25 +91,125 @@ void i2c1_close(void)
     return;
 }
 
-uint8_t i2c1_read(uint8_t addr7bit, uint8_t n, uint8_t* buf)
+uint8_t i2c1_recover(void)
+// Free the bus from a slave that is holding SDA low, by clocking SCL
+// by hand and then making a STOP.  The lines are driven open-drain,
+// by switching TRIS with LAT low, and a slave that stretches SCL
+// is waited for only briefly.
+// Returns 1 if both lines are high afterward.
+{
+    uint8_t i, retries, ok;
+    SSP1CON1bits.SSPEN = 0;
+    LATCbits.LATC3 = 0;
+    LATCbits.LATC4 = 0;
+    TRISCbits.TRISC3 = 1;
+    TRISCbits.TRISC4 = 1;
+    connect_pins(0);
+    __delay_us(5);
+    for (i=0; i < 9 && !SDA_PIN; ++i) {
+        TRISCbits.TRISC3 = 0; // SCL low
+        __delay_us(5);
+        TRISCbits.TRISC3 = 1; // and released
+        retries = 50;
+        while (!SCL_PIN && retries) { __delay_us(2); --retries; }
+        __delay_us(5);
+    }
+    // STOP: SDA goes high while SCL is high.
+    TRISCbits.TRISC3 = 0;
+    __delay_us(5);
+    TRISCbits.TRISC4 = 0;
+    __delay_us(5);
+    TRISCbits.TRISC3 = 1;
+    __delay_us(5);
+    TRISCbits.TRISC4 = 1;
+    __delay_us(5);
+    ok = SCL_PIN && SDA_PIN;
+    connect_pins(1);
+    SSP1CON1bits.WCOL = 0;
+    SSP1CON1bits.SSPEN = 1;
+    PIR3bits.SSP1IF = 0;
+    PIR3bits.BCL1IF = 0;
+    recoveries++;
+    return ok;
+}
+
+static uint8_t device_slot(uint8_t addr7bit)
+// Returns I2C1_N_DEVICES if there is no room for another address.
+{
+    uint8_t d;
+    for (d=0; d < n_devices; ++d) {
+        if (dev_addr[d] == addr7bit) return d;
+    }
+    if (n_devices == I2C1_N_DEVICES) return d;
+    dev_addr[d] = addr7bit;
+    dev_level[d] = 0;
+    dev_skip[d] = 0;
+    n_devices++;
+    return d;
+}
+
+static uint8_t next_skip(uint8_t* level)
+// Transactions to skip after another failure: 1, 3, 7, ...
+{
+    if (*level < I2C1_MAX_BACKOFF) { (*level)++; }
+    return (uint8_t)((1u << *level) - 1);
+}
+
+static uint8_t transaction_start(uint8_t d)
+// Returns 1 if the transaction may go ahead, otherwise sets i2c1_error.
 {
-    uint8_t n_read = 0;
-    uint8_t retries, timeout;
     i2c1_error = 0;
-    uint8_t addrbyte;
-    //
-    // TODO: Look for idle state, but timeout if necessary.
-    //
+    if (bus_skip) {
+        --bus_skip;
+        i2c1_error = 4;
+        return 0;
+    }
+    if (d < I2C1_N_DEVICES && dev_skip[d]) {
+        --dev_skip[d];
+        i2c1_error = 4;
+        return 0;
+    }
+    if (suspect || !SCL_PIN || !SDA_PIN) {
+        if (!i2c1_recover()) {
+            bus_skip = next_skip(&bus_level);
+            i2c1_error = 4;
+            return 0;
+        }
+        suspect = 0;
+        bus_level = 0;
+    }
     if (SSP1CON1bits.WCOL) {
         SSP1CON1bits.WCOL = 0;
         i2c1_error = 2;
-        goto Quit;
+        return 0;
     }
     if (PIR3bits.BCL1IF) {
         PIR3bits.BCL1IF = 0;
         i2c1_error = 3;
-        goto Quit;
+        return 0;
+    }
+    return 1;
+}
+
+static void transaction_end(uint8_t d)
+{
+    if (i2c1_error == 4) return;
+    if (i2c1_error) {
+        // The bus is checked, and freed if need be, next time.
+        suspect = 1;
+        if (d < I2C1_N_DEVICES) { dev_skip[d] = next_skip(&dev_level[d]); }
+    } else if (d < I2C1_N_DEVICES) {
+        dev_level[d] = 0;
     }
+}
+
+uint8_t i2c1_read(uint8_t addr7bit, uint8_t n, uint8_t* buf)
+{
+    uint8_t n_read = 0;
+    uint8_t retries, timeout;
+    uint8_t addrbyte;
+    uint8_t d = device_slot(addr7bit);
+    if (!transaction_start(d)) goto Quit;
     //
     // Start condition.
     PIR3bits.SSP1IF = 0;
@@ -152,28 +293,17 @@ uint8_t i2c1_read(uint8_t addr7bit, uint8_t n, uint8_t* buf)
     //
     Quit:
     SSP1CON2bits.RCEN = 0;
+    transaction_end(d);
     return n_read;
 } // end i2c1_read()
 
 uint8_t i2c1_write(uint8_t addr7bit, uint8_t n, uint8_t* buf)
 {
     uint8_t n_sent = 0;
-    i2c1_error = 0;
     uint8_t retries, timeout;
     uint8_t addrbyte;
-    //
-    // TODO: Look for idle state, but timeout if necessary.
-    //
-    if (SSP1CON1bits.WCOL) {
-        SSP1CON1bits.WCOL = 0;
-        i2c1_error = 2;
-        goto Quit;
-    }
-    if (PIR3bits.BCL1IF) {
-        PIR3bits.BCL1IF = 0;
-        i2c1_error = 3;
-        goto Quit;
-    }
+    uint8_t d = device_slot(addr7bit);
+    if (!transaction_start(d)) goto Quit;
     //
     // Start condition.
     PIR3bits.SSP1IF = 0;
@@ -250,5 +380,114 @@ uint8_t i2c1_write(uint8_t addr7bit, uint8_t n, uint8_t* buf)
     if (timeout) { i2c1_error = 1; }
     //
     Quit:
+    transaction_end(d);
     return n_sent;
 } // end i2c1_write()
+
+uint8_t i2c1_read_register(uint8_t addr7bit, uint8_t reg, uint8_t n, uint8_t* buf)
+// Write the register address then, after a repeated start,
+// read n bytes from that register onward, all in one transaction.
+// Returns the number of bytes read; errors are as for i2c1_read().
+{
+    uint8_t n_read = 0;
+    uint8_t retries, timeout;
+    uint8_t d = device_slot(addr7bit);
+    if (!transaction_start(d)) goto Quit;
+    //
+    // Start condition.
+    PIR3bits.SSP1IF = 0;
+    SSP1CON2bits.SEN = 1;
+    retries = 255; timeout = 1;
+    while (retries) {
+        if (PIR3bits.SSP1IF) { timeout = 0; break; }
+        __delay_us(2); --retries;
+    }
+    PIR3bits.SSP1IF = 0;
+    if (timeout) { i2c1_error = 1; goto Quit; }
+    //
+    // Address slave for writing, then send the register address.
+    for (uint8_t i=0; i < 2; ++i) {
+        SSP1BUF = (i == 0) ? (uint8_t)(addr7bit << 1) : reg;
+        retries = 255; timeout = 1;
+        while (retries) {
+            if (PIR3bits.SSP1IF) { timeout = 0; break; }
+            __delay_us(2); --retries;
+        }
+        PIR3bits.SSP1IF = 0;
+        if (timeout) { i2c1_error = 1; goto Quit; }
+        retries = 255; timeout = 1;
+        while (retries) {
+            if (!SSP1CON2bits.ACKSTAT) { timeout = 0; break; }
+            __delay_us(2); --retries;
+        }
+        if (timeout) { i2c1_error = 1; goto Quit; }
+    }
+    //
+    // Repeated start, and address slave for reading.
+    PIR3bits.SSP1IF = 0;
+    SSP1CON2bits.RSEN = 1;
+    retries = 255; timeout = 1;
+    while (retries) {
+        if (PIR3bits.SSP1IF) { timeout = 0; break; }
+        __delay_us(2); --retries;
+    }
+    PIR3bits.SSP1IF = 0;
+    if (timeout) { i2c1_error = 1; goto Quit; }
+    SSP1BUF = (uint8_t)(addr7bit << 1) | 1;
+    retries = 255; timeout = 1;
+    while (retries) {
+        if (PIR3bits.SSP1IF) { timeout = 0; break; }
+        __delay_us(2); --retries;
+    }
+    PIR3bits.SSP1IF = 0;
+    if (timeout) { i2c1_error = 1; goto Quit; }
+    retries = 255; timeout = 1;
+    while (retries) {
+        if (!SSP1CON2bits.ACKSTAT) { timeout = 0; break; }
+        __delay_us(2); --retries;
+    }
+    if (timeout) { i2c1_error = 1; goto Quit; }
+    //
+    // Now read the data bytes, as in i2c1_read().
+    for (uint8_t i=0; i < n; ++i) {
+        SSP1CON2bits.RCEN = 1;
+        retries = 255; timeout = 1;
+        while (retries) {
+            if (SSP1STATbits.BF) {
+                PIR3bits.SSP1IF = 0;
+                buf[i] = SSP1BUF;
+                SSP1STATbits.BF = 0;
+                timeout = 0; break;
+            }
+            __delay_us(20); --retries;
+        }
+        if (timeout) { i2c1_error = 1; goto Quit; }
+        SSP1CON2bits.ACKDT = (i == (n-1)) ? 1 : 0; // NACK the last byte.
+        PIR3bits.SSP1IF = 0;
+        SSP1CON2bits.ACKEN = 1;
+        retries = 255; timeout = 1;
+        while (retries) {
+            if (PIR3bits.SSP1IF) { timeout = 0; break; }
+            __delay_us(2); --retries;
+        }
+        PIR3bits.SSP1IF = 0;
+        if (timeout) { i2c1_error = 1; goto Quit; }
+        ++n_read;
+    }
+    SSP1CON2bits.RCEN = 0;
+    // Stop condition
+    PIR3bits.SSP1IF = 0;
+    SSP1CON2bits.PEN = 1;
+    retries = 255; timeout = 1;
+    while (retries) {
+        if (PIR3bits.SSP1IF) { timeout = 0; break; }
+        __delay_us(2); --retries;
+    }
+    PIR3bits.SSP1IF = 0;
+    if (timeout) { i2c1_error = 1; }
+    //
+    Quit:
+    SSP1CON2bits.RCEN = 0;
+    transaction_end(d);
+    return n_read;
+} // end i2c1_read_register()
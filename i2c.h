@@ -5,10 +5,22 @@
 #define MY_I2C
 #include <stdint.h>
 
+// Error codes from i2c1_get_error_flag(), for the latest transaction:
+// 0 none, 1 timeout, 2 write collision, 3 bus collision,
+// 4 skipped while backing off from a failed device or a stuck bus.
+
+// Devices whose failures are backed off from, each by its own count.
+#define I2C1_N_DEVICES 4
+// Longest back-off is 2^I2C1_MAX_BACKOFF - 1 transactions.
+#define I2C1_MAX_BACKOFF 7
+
 uint8_t i2c1_get_error_flag(void);
+uint16_t i2c1_get_recoveries(void);
 void i2c1_init(void);
 void i2c1_close(void);
+uint8_t i2c1_recover(void);
 uint8_t i2c1_read(uint8_t addr7bit, uint8_t n, uint8_t* buf);
 uint8_t i2c1_write(uint8_t addr7bit, uint8_t n, uint8_t* buf);
+uint8_t i2c1_read_register(uint8_t addr7bit, uint8_t reg, uint8_t n, uint8_t* buf);
 
 #endif
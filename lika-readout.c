@@ -16,9 +16,29 @@
 // PJ 2025-02-03 Andy's request to put \n at end of UART messages.
 //               Switch to allow higher frequency reporting.
 // PJ 2025-02-04 Add forgotten comma.
+// PJ 2026-10-18 External trigger input on RC0 latches both encoders.
+//               Burst capture to RAM, commands from the host.
+//               Compressed (delta and run-length) output format.
+//               Deadband and heartbeat for UART records and LED display.
+//               Baud rates up to 2Mbaud, checked; optional auto-baud.
+//               FOSC of 32MHz or 64MHz, selected at build time.
+//               Wait in Idle mode for the end of the cycle; report slack time.
+//               Health counters, reported on request, in place of
+//               the i2c error messages in the data stream.
+//               Time-sync exchange with the host (Y command).
+//               I2C bus recovery, and back-off from a dead LCD or AS5600.
+//               Quadrature (A/B/Z) output from either channel (I command).
+//               Incremental encoder input, counted by CLC and timers, as channel B.
+//               Position-compare outputs with windows kept in EEPROM (L command).
+//               Analog (PWM) output of either channel on RB2 (V command).
+//               Per-channel nonlinearity correction tables in EEPROM (N command).
+//               Wrap-aware low-pass filter of each raw reading (F command).
+//               Windowed min/max/mean/sd summaries in place of samples (G command).
+//               Settings kept in EEPROM and changed while running (O, E commands).
+//               Config records both channels as Lika AS36 (see encoder-mixed.h).
 //
 // This version string will be printed shortly after MCU reset.
-#define VERSION_STR "v2.2 2025-02-04"
+#define VERSION_STR "v2.21 2026-10-18"
 //
 // Configuration Bit Settings (generated from Config Memory View)
 // CONFIG1L
@@ -70,15 +90,33 @@
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "eeprom.h"
 #include "uart.h"
 #include "timer2-free-run.h"
 #include "lika-as36.h"
 #include "i2c.h"
 #include "spi-max7219.h"
+#include "timestamp.h"
+#include "trigger.h"
+#include "command.h"
+#include "capture.h"
+#include "delta-stream.h"
+#include "deadband.h"
+#include "stats.h"
+#include "quad-out.h"
+#include "quad-in.h"
+#include "compare.h"
+#include "analog-out.h"
+#include "calib.h"
+#include "filter.h"
+#include "summary.h"
+#include "encoder-mixed.h"
+#include "config.h"
 
 #define GREENLED LATBbits.LATB5
 #define SW0 PORTAbits.RA0
@@ -94,6 +132,50 @@ static char char_buffer[NCBUF];
 #define ADDR_LCD 0x51
 #define ADDR_AS5600 0x36
 
+// Configuration that is also needed by the interrupt service routine.
+static uint8_t use_quad_in = 0; // Incremental encoder on RB6/RB7 in place of channel B (O7).
+
+// Things needed for the external trigger input.
+// The interrupt service routine latches the encoders when a trigger edge
+// arrives, so the main loop must hold off interrupts while it is
+// clocking the SSI lines itself.
+void __interrupt() isr(void)
+{
+    uint16_t a, b;
+    uint32_t t_latch;
+    int32_t count = 0;
+    timestamp_service_irq();
+    timer2_service_irq();
+    uart1_service_irq();
+    quad_out_service_irq();
+    quad_in_service_irq();
+    if (trigger_edge_pending()) {
+        t_latch = timestamp_now();
+        if (use_quad_in) { count = quad_in_count_now(); }
+        read_AS36_encoders(&a, &b);
+        // The incremental count, taken with the frame, is scaled
+        // only now so as not to delay the latch.
+        if (use_quad_in) { b = quad_in_count_position(count, 16); }
+        trigger_push(a, b, t_latch);
+    }
+}
+
+// Trigger records that arrive while we wait for the next cycle are
+// sent from the wait, rather than a cycle later, so long as each line
+// is out before t_send_by, a line's time ahead of the next sample.
+static uint32_t t_send_by = 0;
+
+static void send_trigger_records(void)
+{
+    // The idle task for timer2_wait().
+    int n;
+    trigger_record_t rec;
+    while ((int32_t)(t_send_by - timestamp_now()) > 0 && trigger_pop(&rec)) {
+        n = printf("T,%u,%lu,%u,%4u,%4u\r\n", rec.seq, rec.t_edge,
+                   rec.latency, rec.a, rec.b);
+    }
+}
+
 void display_to_lcd_unsigned(uint16_t a, uint16_t b)
 {
     int n;
@@ -101,6 +183,9 @@ void display_to_lcd_unsigned(uint16_t a, uint16_t b)
     // Set cursor to DDRAM address 0
     char_buffer[0] = 0xfe; char_buffer[1] = 0x45; char_buffer[2] = 0x00;
     n = i2c1_write(ADDR_LCD, 3, (uint8_t*)char_buffer);
+    // If the LCD is not answering, or is being backed off from,
+    // don't spend the rest of the cycle writing to it.
+    if (i2c1_get_error_flag()) return;
     __delay_ms(3); // Give the LCD time
     n = sprintf(char_buffer, "A:%4u B:%4u    ", a, b);
     for (uint8_t i=0; i < NCBUF; ++i) {
@@ -140,6 +225,13 @@ void values_to_string_buffer(int16_t a, int16_t b, char* chrs)
     }
 }
 
+uint8_t read_switches(void)
+{
+    // The DIP switches as config.c wants them.
+    return (SW0 ? CONFIG_SW0 : 0) | (SW1 ? CONFIG_SW1 : 0) |
+        (SW2 ? CONFIG_SW2 : 0) | (SW3 ? CONFIG_SW3 : 0);
+}
+
 int main(void)
 {
     int n;
@@ -149,6 +241,20 @@ int main(void)
     int32_t a_signed, b_signed; // 32-bit to store angles in 1/100 degree resolution.
     int32_t big; // working variable for scaling to degrees
     char digits_buffer[16]; // string of characters to display signed values
+    char cmd_buffer[COMMAND_LEN]; // command line from the host
+    long args[4]; // numbers that follow the command letter
+    uint8_t nargs;
+    long baud_actual;
+    int16_t baud_err;
+    deadband_t uart_gate, display_gate;
+    uint16_t sample_seq = 0; // counts every sample
+    uint16_t record_seq = 0; // counts records sent when using the deadband
+    uint32_t t_sample = 0; // when the latest sample was taken
+    uint32_t t_reply; // when we answer a time-sync request
+    uint32_t t_wait; // start of slack time
+    uint32_t slack_us = 0; // slack time in the most recent cycle
+    uint32_t min_slack_us = 0xffffffff; // and the least seen
+    uint32_t cycle_us; // nominal period of the main loop
     //
     uint8_t lcd_count_display = 0;
     uint8_t lcd_count_clear = 0;
@@ -156,12 +262,31 @@ int main(void)
     //
     // Default/expected configuration.
     uint8_t use_uart = 1;
+    long uart_baud = UART1_DEFAULT_BAUD; // Up to 1000000 or 2000000 as the host allows.
+    uint8_t use_autobaud = 0; // Look for the host's 'U' just after reset.
     uint8_t with_rts_cts = 1;
     uint8_t use_i2c_lcd = 0;
     uint8_t use_spi_led_display = 1;
-    uint8_t fast_cycle = 1;
+    uint8_t cycle_count = CONFIG_FAST_COUNT; // Timer2 periods of 16.5ms
+    uint8_t new_cycle_count; // from the O command, for the next cycle
+    config_t cfg; // settings saved in EEPROM, for the E command
+    uint8_t have_config;
+    uint8_t use_trigger = 1;
+    uint8_t use_delta_stream = 0; // Selected by command from the host.
+    uint16_t delta_keyframe = 20;
+    uint8_t use_deadband = 0; // Selected by command from the host.
+    uint16_t quad_lines = 0; // Selected by command from the host; 0 for off.
+    uint16_t summary_s = 0; // G window in seconds; 0 for off
+    uint16_t quad_in_lines = 0; // of the incremental encoder on RB6/RB7; 0 for none
+    uint16_t next_quad_in_lines; // from the O command, for the next reset
+    uint8_t quad_channel = 1; // 0 for A, 1 for B
+    uint8_t use_analog_out = 0; // Selected by command from the host.
+    uint8_t analog_channel = 1; // 0 for A, 1 for B
+    int16_t analog_zero = 0; // 1/100 degree at mid-scale
+    uint16_t analog_span = 36000; // 1/100 degree over the full scale
+    uint8_t wait_mode = TIMER2_WAIT_IDLE; // Save power in the slack time.
     //
-    OSCFRQbits.HFFRQ = 0b0110; // Select 32MHz.
+    clock_init(); // Select FOSC, as set in global_defs.h.
     TRISBbits.TRISB5 = 0; // Pin as output for LED.
     GREENLED = 0;
     TRISBbits.TRISB4 = 1; ANSELBbits.ANSELB4 = 0; WPUBbits.WPUB4 = 1; // PUSHBUTTONA
@@ -172,8 +297,25 @@ int main(void)
     TRISAbits.TRISA1 = 1; ANSELAbits.ANSELA1 = 0; WPUAbits.WPUA1 = 1; // Input SW1
     TRISAbits.TRISA2 = 1; ANSELAbits.ANSELA2 = 0; WPUAbits.WPUA2 = 1; // Input SW2
     TRISAbits.TRISA3 = 1; ANSELAbits.ANSELA3 = 0; WPUAbits.WPUA3 = 1; // Input SW3
-    if (SW0) { fast_cycle = 1; } else { fast_cycle = 0; }
-    if (SW1) { with_rts_cts = 1; } else { with_rts_cts = 0; }
+    // Settings saved from the host stand, unless a switch has been
+    // moved since they were saved (config.c).  SW2 and SW3 have no use here.
+    cfg.cycle_count = cycle_count; cfg.rts_cts = with_rts_cts;
+    cfg.as5600 = 0; cfg.aeat_12bit = 0; cfg.ssi_types = SSI_A_AS36 | SSI_B_AS36;
+    cfg.lcd = use_i2c_lcd; cfg.led_display = use_spi_led_display;
+    cfg.delta_stream = use_delta_stream; cfg.keyframe = delta_keyframe;
+    cfg.quad_in_lines = quad_in_lines; cfg.as5600_pwm = 0;
+    have_config = config_load(&cfg, read_switches());
+    cycle_count = cfg.cycle_count; with_rts_cts = cfg.rts_cts;
+    use_i2c_lcd = cfg.lcd; use_spi_led_display = cfg.led_display;
+    use_delta_stream = cfg.delta_stream; delta_keyframe = cfg.keyframe;
+    quad_in_lines = cfg.quad_in_lines;
+    use_quad_in = (quad_in_lines != 0);
+    next_quad_in_lines = quad_in_lines;
+    //
+    stats_init(); // Also notes a watchdog reset in EEPROM.
+    calib_init();
+    filter_init(0, 16);
+    filter_init(1, 16);
     //
     // Get ref values out of EEPROM.
     a_ref = (uint16_t) (DATAEE_ReadByte(1) << 8) | DATAEE_ReadByte(0);
@@ -182,16 +324,31 @@ int main(void)
     // Initialize the peripherals that are in play.
     init_AS36_encoders();
     if (use_uart) {
-        uart1_init(115200);
+        if (uart1_init(uart_baud)) {
+            // The clock cannot make the requested rate closely enough.
+            uart1_init(UART1_DEFAULT_BAUD);
+        }
+        uart1_set_flow_control(with_rts_cts);
         __delay_ms(50); // Need a bit of delay to not miss the first characters.
         uart1_flush_rx();
+        if (use_autobaud) {
+            // The host may send a 'U' within 2 seconds of reset
+            // to set our baud rate to its own.
+            uart1_autobaud(2000);
+        }
         n = printf("Lika AS36 encoder readout.\r\n");
         n = printf("%s\r\n", VERSION_STR);
+        n = printf("FOSC %ld Hz.\r\n", FOSC);
+        if (have_config) {
+            n = printf("Settings from EEPROM, with any switches moved since.\r\n");
+        }
         if (with_rts_cts) {
             n = printf("Using RTS/CTS.\r\n");
         } else {
             n = printf("NOT using RTS/CTS.\r\n");
         }
+        n = printf("Baud rate %ld, error %d/10000.\r\n",
+                   uart1_get_actual_baud(), uart1_get_baud_error());
         n = printf("a_ref: %4u  b_ref: %4u\r\n", a_ref, b_ref);
     }
     if (use_i2c_lcd) {
@@ -202,18 +359,60 @@ int main(void)
         spi2_init();
         max7219_init();
     }
-    if (fast_cycle) {
-        timer2_init(3, 8); // 3 * 2.064ms * 8 = 50ms period
-        n = printf("Cycle period is 50ms.\r\n");
+    // 3 * 2.064ms * 8 = 50ms period, 7 * 2.064ms * 8 = 116ms period
+    timer2_init(cycle_count, 8);
+    cycle_us = cycle_count * CONFIG_US_PER_COUNT;
+    new_cycle_count = cycle_count;
+    n = printf("Cycle period is %lu us.\r\n", cycle_us);
+    if (use_delta_stream) { delta_stream_init(16, delta_keyframe); }
+    timestamp_init();
+    if (use_trigger) {
+        trigger_init();
+        n = printf("Trigger input on RC0.\r\n");
+    }
+    if (use_quad_in) {
+        quad_in_init(quad_in_lines);
+        n = printf("Incremental encoder, %u lines, on RB6/RB7 as channel B.\r\n", quad_in_lines);
     } else {
-        timer2_init(7, 8); // 7 * 2.064ms * 8 = 116ms period
-        n = printf("Cycle period is 116ms.\r\n");
+        // The compare outputs share RB6/RB7 with the incremental input.
+        compare_init();
     }
+    if (use_uart) { uart1_enable_rx_interrupt(); }
+    timer2_set_wait_mode(wait_mode);
+    if (use_trigger && use_uart) { timer2_set_idle_task(send_trigger_records); }
+    INTCONbits.PEIE = 1;
+    ei();
     //
     timer2_wait();
     while (1) {
+        // 0. A burst capture, if armed, takes samples as fast as
+        //    the SSI encoders can be read and then we carry on as usual.
+        //    Interrupts are held off for each frame, as in step 1, and
+        //    are served in between.
+        if (capture_is_armed()) {
+            do {
+                CLRWDT();
+                di();
+                read_AS36_encoders(&a_raw, &b_raw);
+                ei();
+            } while (capture_store(a_raw, b_raw));
+        }
         // 1. Read the raw values from the sensors.
+        di(); // The trigger interrupt also clocks the SSI lines.
+        t_sample = timestamp_now();
         read_AS36_encoders(&a_raw, &b_raw);
+        if (use_quad_in) { quad_in_latch(); }
+        ei();
+        stats_count(STATS_SAMPLES);
+        // With the incremental encoder in use, nothing is connected to DI-B.
+        stats_check_ssi(a_raw, (use_quad_in) ? 0 : b_raw, 0xffff, 0xffff);
+        if (use_quad_in) {
+            // Scaled to the AS36 resolution, for the rest of the pipeline.
+            b_raw = quad_in_position(16);
+        }
+        // Low-pass filter, if selected, on every sample (filter.c).
+        a_raw = filter_apply(0, a_raw);
+        b_raw = filter_apply(1, b_raw);
         // 2. If the push buttons are active (low), set the reference values.
         if (PUSHBUTTONA == 0) {
             a_ref = a_raw;
@@ -237,17 +436,47 @@ int main(void)
         a_signed = big/2048;
         big = b_signed * 1125;
         b_signed = big/2048;
+        // Nonlinearity correction, at the reading less that at the
+        // reference; nothing is added for a channel without a table.
+        a_signed += calib_correction(0, a_raw, 16) - calib_correction(0, a_ref, 16);
+        b_signed += calib_correction(1, b_raw, 16) - calib_correction(1, b_ref, 16);
         // 4. Bring into -180 to 180 degree range by wrapping around.
         if (a_signed < -18000) a_signed += 36000;
         if (a_signed > 18000) a_signed -= 36000;
         if (b_signed < -18000) b_signed += 36000;
         if (b_signed > 18000) b_signed -= 36000;
+        // The position-compare outputs go first, to keep their latency short.
+        if (!use_quad_in) { compare_update((int16_t)a_signed, (int16_t)b_signed, t_sample); }
+        if (use_analog_out) { analog_out_update((int16_t)a_signed, (int16_t)b_signed); }
         //
         // 5. Some output.
-        if (use_uart) {
-            uart1_flush_rx();
-            values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
-            n = printf("%4u,%4u,%s\r\n", a_raw, b_raw, digits_buffer);
+        //    With the deadband in use, records carry the sample number
+        //    and the record number, so that the host can tell
+        //    suppressed samples from lost records.
+        //    While summaries are selected, they take the place of
+        //    the per-sample records, so as to keep the link quiet.
+        sample_seq++;
+        if (summary_add((int16_t)a_signed, (int16_t)b_signed)) { summary_report(); }
+        if (use_uart && summary_get_interval() == 0) {
+            if (use_delta_stream) {
+                delta_stream_put(a_raw, b_raw);
+            } else if (!use_deadband) {
+                values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
+                n = printf("%4u,%4u,%s\r\n", a_raw, b_raw, digits_buffer);
+            } else if (deadband_check(&uart_gate, a_raw, b_raw)) {
+                values_to_string_buffer((int16_t)a_signed, (int16_t)b_signed, digits_buffer);
+                n = printf("%4u,%4u,%s,%u,%u\r\n", a_raw, b_raw, digits_buffer,
+                           sample_seq, record_seq++);
+            }
+        }
+        if (use_trigger) {
+            trigger_record_t rec;
+            while (trigger_pop(&rec)) {
+                if (use_uart) {
+                    n = printf("T,%u,%lu,%u,%4u,%4u\r\n", rec.seq, rec.t_edge,
+                               rec.latency, rec.a, rec.b);
+                }
+            }
         }
         if (use_i2c_lcd) {
             if (lcd_count_clear == 0) {
@@ -272,27 +501,348 @@ int main(void)
             } else {
                 lcd_count_display--;
             }
-            uint8_t err = i2c1_get_error_flag();
-            if (err && use_uart) { printf("  i2c err=%u", err); }
+            stats_count_i2c_error(i2c1_get_error_flag());
         }
         if (use_spi_led_display) {
             if (led_count_display == 0) {
-                // spi2_led_display_unsigned(a_raw, b_raw);
-                // Display integral degrees only to 7-segment LED display.
-                spi2_led_display_signed((int16_t)(a_signed/100), (int16_t)(b_signed/100));
-                led_count_display = 0; // every pass for Jeremy
+                // A redraw held back by the deadband leaves the count at 0.
+                if (!use_deadband || deadband_check(&display_gate, a_raw, b_raw)) {
+                    // spi2_led_display_unsigned(a_raw, b_raw);
+                    // Display integral degrees only to 7-segment LED display.
+                    spi2_led_display_signed((int16_t)(a_signed/100), (int16_t)(b_signed/100));
+                    led_count_display = 0; // every pass for Jeremy
+                }
             } else {
                 led_count_display--;
             }
         }
+        if (quad_lines) {
+            // The index pulse marks the reference position.
+            quad_out_update((quad_channel) ? b_raw - b_ref : a_raw - a_ref);
+        }
+        // 6. Commands from the host.
+        if (use_uart && command_poll(cmd_buffer)) {
+            switch (cmd_buffer[0]) {
+            case 'C':
+                // Arm a burst capture: C starts immediately,
+                // CT waits for an edge on the trigger input.
+                if (cmd_buffer[1] == 'T' && !use_trigger) {
+                    n = printf("C,no-trigger\r\n");
+                    break;
+                }
+                capture_arm(16, (cmd_buffer[1] == 'T'));
+                n = printf("C,armed\r\n");
+                break;
+            case 'D':
+                // Dump the burst capture, a line at a time.
+                if (!capture_dump_start()) { n = printf("D,none\r\n"); }
+                break;
+            case 'M':
+                // Output format: M0 for text lines,
+                // M1[,k] for compressed with a keyframe every k samples.
+                if (use_delta_stream) { delta_stream_flush(); }
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (nargs >= 1 && args[0] == 1) {
+                    if (nargs < 2) { args[1] = 20; }
+                    if (args[1] < 1) { args[1] = 1; }
+                    delta_keyframe = (uint16_t)args[1];
+                    delta_stream_init(16, (uint16_t)args[1]);
+                    use_delta_stream = 1;
+                } else {
+                    use_delta_stream = 0;
+                }
+                n = printf("M,%u\r\n", use_delta_stream);
+                break;
+            case 'Q':
+                // Deadband: Qa,b,h sends a record (and redraws the display)
+                // only when channel A or B has moved by more than a or b
+                // counts, or after h samples without a record.
+                // Q alone goes back to sending every sample.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs == 3) {
+                    deadband_init(&uart_gate, 16, 16, (uint16_t)args[0],
+                                  (uint16_t)args[1], (uint16_t)args[2]);
+                    display_gate = uart_gate;
+                    use_deadband = 1;
+                } else {
+                    use_deadband = 0;
+                }
+                n = printf("Q,%u\r\n", use_deadband);
+                break;
+            case 'B':
+                // Change baud rate: Bn replies at the old rate and then
+                // switches to n baud, if it can be made closely enough.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1 && uart1_check_baud(args[0], &baud_actual, &baud_err) == 0) {
+                    n = printf("B,%ld,%d\r\n", baud_actual, baud_err);
+                    uart1_wait_tx_done();
+                    uart1_set_baud(args[0]);
+                    uart_baud = args[0];
+                } else {
+                    n = printf("B,refused\r\n");
+                }
+                break;
+            case 'A':
+                // Auto-baud: after our reply, the host switches to
+                // its new rate and sends 'U' within 5 seconds.
+                n = printf("A,wait\r\n");
+                uart1_wait_tx_done();
+                if (uart1_autobaud(5000)) { uart_baud = uart1_get_actual_baud(); }
+                n = printf("A,%ld\r\n", uart1_get_actual_baud());
+                break;
+            case 'W':
+                // Wait mode: W reports the mode and the slack time (us)
+                // in the last cycle and the least seen.
+                // Wm selects 0 for spin, 1 for Idle, 2 for Doze
+                // and starts the least-slack measurement again.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) {
+                    timer2_set_wait_mode((uint8_t)args[0]);
+                    min_slack_us = 0xffffffff;
+                }
+                n = printf("W,%u,%lu,%lu\r\n", timer2_get_wait_mode(), slack_us, min_slack_us);
+                break;
+            case 'S':
+                // Health counters: S reports them, S0 clears them.
+                if (cmd_buffer[1] == '0') { stats_clear(); }
+                stats_report();
+                break;
+            case 'I':
+                // Quadrature output: Il[,c] gives l lines per turn
+                // from channel c (0 for A, 1 for B, the default);
+                // I0 stops it.  The pins are those of the LED display,
+                // and the counting hardware that of the incremental input.
+                // The most lines depends on the cycle (quad-out.c).
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (use_spi_led_display) {
+                    n = printf("I,no-pins\r\n");
+                    break;
+                }
+                if (use_quad_in) {
+                    n = printf("I,in-use\r\n");
+                    break;
+                }
+                if (nargs >= 1 && args[0] > (long)quad_out_max_lines(cycle_us)) {
+                    // Half a turn of steps would not fit in the cycle,
+                    // so the output could fall behind the shaft.
+                    n = printf("I,refused,%u\r\n", quad_out_max_lines(cycle_us));
+                    break;
+                }
+                if (nargs >= 1) {
+                    quad_lines = (args[0] > 0 && args[0] <= 16383) ? (uint16_t)args[0] : 0;
+                    quad_channel = (nargs < 2 || args[1] != 0);
+                    if (quad_lines) {
+                        quad_out_init(quad_lines, 16, cycle_us);
+                    } else {
+                        quad_out_close();
+                    }
+                }
+                n = printf("I,%u,%u,%u\r\n", quad_lines, quad_channel, quad_out_get_position());
+                break;
+            case 'L':
+                // Position-compare (limit switch) outputs: L reports them;
+                // Lc,lo,hi,h sets the window for channel c (0 for A, 1 for B)
+                // in 1/100 degree, with hysteresis h, and Lc turns it off.
+                // Settings are kept in EEPROM.
+                if (use_quad_in) {
+                    n = printf("L,no-pins\r\n");
+                    break;
+                }
+                nargs = command_parse_args(cmd_buffer, args, 4);
+                if (nargs >= 1 && (args[0] < 0 || args[0] > 1)) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                // Angles outside -18000 to 18000, or hysteresis over 18000,
+                // are refused rather than stored.
+                if (nargs == 4 && compare_set((uint8_t)args[0], 1, args[1], args[2], args[3])) {
+                    n = printf("L,refused\r\n");
+                    break;
+                } else if (nargs == 1) {
+                    compare_set((uint8_t)args[0], 0, 0, 0, 0);
+                }
+                compare_report();
+                break;
+            case 'V':
+                // Analog (PWM) output: V1[,c[,z,s]] gives channel c
+                // (0 for A, 1 for B) with z at mid-scale and s over
+                // the full scale, in 1/100 degree; V0 stops it.
+                // The pin is one of the LED display's.
+                nargs = command_parse_args(cmd_buffer, args, 4);
+                if (use_spi_led_display) {
+                    n = printf("V,no-pins\r\n");
+                    break;
+                }
+                if (nargs >= 1) {
+                    use_analog_out = (args[0] != 0);
+                    if (nargs >= 2) { analog_channel = (args[1] != 0); }
+                    if (nargs >= 4 && args[3] > 0 && args[3] <= 36000) {
+                        analog_zero = (int16_t)args[2];
+                        analog_span = (uint16_t)args[3];
+                    }
+                    if (use_analog_out) {
+                        analog_out_init(analog_channel, analog_zero, analog_span);
+                    } else {
+                        analog_out_close();
+                    }
+                }
+                n = printf("V,%u,%u,%d,%u,%u\r\n", use_analog_out, analog_channel,
+                           analog_zero, analog_span, analog_out_get_duty());
+                break;
+            case 'N':
+                // Nonlinearity correction: Nc reports channel c (0 for A,
+                // 1 for B); Nc,e turns its table on (1) or off (0) and
+                // Nc,i,v sets point i to v, in 1/100 degree.
+                // The tables, from host/calib-fit, are kept in EEPROM.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs < 1 || args[0] < 0 || args[0] > 1) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                if (nargs == 2) { calib_set_enabled((uint8_t)args[0], (args[1] != 0)); }
+                if (nargs == 3) {
+                    if (args[1] < 0 || args[1] >= CALIB_POINTS) {
+                        n = printf("?\r\n");
+                        break;
+                    }
+                    calib_set_point((uint8_t)args[0], (uint8_t)args[1], (int16_t)args[2]);
+                    n = printf("N,%u,%u,%u,%d\r\n", (uint8_t)args[0], calib_get_enabled((uint8_t)args[0]),
+                               (uint8_t)args[1], calib_get_point((uint8_t)args[0], (uint8_t)args[1]));
+                    break;
+                }
+                n = printf("N,%u,%u\r\n", (uint8_t)args[0], calib_get_enabled((uint8_t)args[0]));
+                break;
+            case 'F':
+                // Low-pass filter: Fc reports channel c (0 for A, 1 for B);
+                // Fc,o,k sets order o (0 for off, 1 or 2) with each stage
+                // taking 1/2^k of the step per sample.
+                nargs = command_parse_args(cmd_buffer, args, 3);
+                if (nargs < 1 || args[0] < 0 || args[0] > 1) {
+                    n = printf("?\r\n");
+                    break;
+                }
+                if (nargs == 3 && args[1] >= 0 && args[2] >= 0) {
+                    filter_set((uint8_t)args[0], (uint8_t)args[1], (uint8_t)args[2]);
+                }
+                n = printf("F,%u,%u,%u\r\n", (uint8_t)args[0], filter_get_order((uint8_t)args[0]),
+                           filter_get_shift((uint8_t)args[0]));
+                break;
+            case 'G':
+                // Summary statistics: Gs gives a G line every s seconds,
+                // in place of the per-sample records; G0 stops them.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1 && args[0] >= 0 && args[0] <= 2000) {
+                    summary_s = (uint16_t)args[0];
+                    summary_set_interval(summary_cycles(summary_s, cycle_us));
+                }
+                n = printf("G,%u\r\n", summary_get_interval());
+                break;
+            case 'O':
+                // Options, in effect from the next cycle:
+                //   O0,c  cycle of c periods of 16.5ms (1-15; 3 for 50ms)
+                //   O1,f  RTS/CTS flow control (0 or 1)
+                //   O3,e  LCD (0 or 1)
+                //   O4,e  LED display (0 or 1)
+                //   O7,l  incremental encoder of l lines on RB6/RB7 as channel B
+                //         (0 for none), from the next reset
+                // O2, O5 and O6, for the other encoders, are reported as 16, 0 and 3.
+                // O alone reports them; E1 keeps them in EEPROM.
+                nargs = command_parse_args(cmd_buffer, args, 2);
+                if (nargs == 2 && args[0] == 0) {
+                    if (args[1] >= 1 && args[1] <= CONFIG_MAX_COUNT) { new_cycle_count = (uint8_t)args[1]; }
+                } else if (nargs == 2 && args[0] == 1) {
+                    with_rts_cts = (args[1] != 0);
+                    uart1_set_flow_control(with_rts_cts);
+                } else if (nargs == 2 && args[0] == 3) {
+                    if (args[1] && !use_i2c_lcd) { i2c1_init(); }
+                    if (!args[1] && use_i2c_lcd) { i2c1_close(); }
+                    use_i2c_lcd = (args[1] != 0);
+                } else if (nargs == 2 && args[0] == 4) {
+                    if (args[1] && !use_spi_led_display) {
+                        if (quad_lines || use_analog_out) {
+                            n = printf("O,no-pins\r\n");
+                            break;
+                        }
+                        spi2_init();
+                        max7219_init();
+                    }
+                    if (!args[1] && use_spi_led_display) { spi2_close(); }
+                    use_spi_led_display = (args[1] != 0);
+                } else if (nargs == 2 && args[0] == 7 && args[1] >= 0 && args[1] <= 16383) {
+                    next_quad_in_lines = (uint16_t)args[1];
+                }
+                n = printf("O,%u,%u,16,%u,%u,0,3,%u\r\n", new_cycle_count, with_rts_cts,
+                           use_i2c_lcd, use_spi_led_display, next_quad_in_lines);
+                break;
+            case 'E':
+                // Settings in EEPROM: E1 keeps those of the O and M commands,
+                // noting the switches as they are now; E0 forgets them,
+                // so that the built-in settings and the switches apply.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                if (nargs == 1) {
+                    if (args[0]) {
+                        cfg.cycle_count = new_cycle_count; cfg.rts_cts = with_rts_cts;
+                        cfg.as5600 = 0; cfg.aeat_12bit = 0; cfg.ssi_types = SSI_A_AS36 | SSI_B_AS36;
+                        cfg.lcd = use_i2c_lcd; cfg.led_display = use_spi_led_display;
+                        cfg.delta_stream = use_delta_stream; cfg.keyframe = delta_keyframe;
+                        cfg.quad_in_lines = next_quad_in_lines; cfg.as5600_pwm = 0;
+                        config_save(&cfg, read_switches());
+                    } else {
+                        config_erase();
+                    }
+                }
+                n = printf("E,%u\r\n", config_saved());
+                break;
+            case 'Y':
+                // Time sync: the host sends Y,n and we echo n with our
+                // times (us) for the arrival of that line and for this
+                // reply, followed by the number and time of the latest sample.
+                nargs = command_parse_args(cmd_buffer, args, 1);
+                t_reply = timestamp_now();
+                n = printf("Y,%ld,%lu,%lu,%u,%lu\r\n", (nargs == 1) ? args[0] : 0L,
+                           uart1_get_rx_eol_time(), t_reply, sample_seq, t_sample);
+                break;
+            default:
+                n = printf("?\r\n");
+            }
+        } else if (use_uart) {
+            capture_dump_next();
+        }
         // Light LED to indicate slack time.
         // We can use the oscilloscope to measure the slack time,
         // in case we don't allow enough time for the tasks.
+        // We also measure it ourselves, for the W command.
         GREENLED = 1;
-        timer2_wait();
+        t_wait = timestamp_now();
+        // A T line is up to 40 characters.
+        t_send_by = t_sample + cycle_us - 400000000L / uart_baud;
+        if (timer2_wait()) { stats_count(STATS_OVERRUNS); }
+        slack_us = timestamp_now() - t_wait;
+        if (slack_us < min_slack_us) { min_slack_us = slack_us; }
         GREENLED = 0;
+        if (new_cycle_count != cycle_count) {
+            // A cycle period from the O command starts here.
+            timer2_set_period(new_cycle_count);
+            cycle_count = new_cycle_count;
+            cycle_us = cycle_count * CONFIG_US_PER_COUNT;
+            // The G window keeps its length in seconds, and the
+            // quadrature moves are spread over the new cycle, with
+            // fewer lines if the old number would no longer keep up.
+            if (summary_s) { summary_set_interval(summary_cycles(summary_s, cycle_us)); }
+            if (quad_lines > quad_out_max_lines(cycle_us)) {
+                quad_lines = quad_out_max_lines(cycle_us);
+                quad_out_init(quad_lines, 16, cycle_us);
+            } else if (quad_lines) {
+                quad_out_set_cycle(cycle_us);
+            }
+        }
     }
     // Don't actually expect to arrive here but, just to keep things tidy...
+    di();
+    if (use_trigger) { trigger_close(); }
+    if (quad_lines) { quad_out_close(); }
+    if (use_analog_out) { analog_out_close(); }
+    if (use_quad_in) { quad_in_close(); } else { compare_close(); }
     timer2_close();
     if (use_i2c_lcd) { i2c1_close(); }
     if (use_uart) uart1_close();
@@ -0,0 +1,230 @@
+// quad-in.c
+// Incremental (A/B quadrature) encoder input, counted in hardware.
+//   A  RB6
+//   B  RB7
+// These are also the ICSP pins, so the encoder must be unplugged
+// for programming.  There is no spare pin for an index (Z) input;
+// the count starts from 0 at reset and the reference is set with
+// the push button, as for the absolute encoders.
+//
+// Every edge of A and B is counted (4 counts per line) by six CLCs
+// and three timers, with no interrupt per edge:
+//   Timer4      sample clock, QUAD_IN_SAMPLE_HZ (clock.h), 4MHz
+//   CLC3, CLC4  A1, B1: A and B sampled at each sample clock
+//   CLC5, CLC6  A2, B2: A1 and B1 one sample later
+//   CLC7        up pulse,   (A1 xor B2) and not (A2 xor B1)
+//   CLC8        down pulse, (A2 xor B1) and not (A1 xor B2)
+// Between one sample and the next, only a step forward makes A1 differ
+// from B2 while A2 matches B1, and only a step back does the reverse,
+// so each step makes one pulse, one sample period wide, on one output.
+// Each function is a product of four two-input ORs, which the
+// 4-input AND mode makes directly.  Timer3 counts up pulses and Timer5
+// down pulses, synchronised to the system clock, and their overflows
+// extend them to 32 bits.  The pulses, 250ns high and at least as long
+// low, are well within the data sheet's limits for a synchronised
+// timer input; FOSC-wide pulses, counted asynchronously, were not.
+// Edges of A and B must be 2 samples (500ns) apart, so the count keeps
+// up with at most 2 million edges per second, 500000 lines per second,
+// and less where the encoder's edges are unevenly spaced.
+//
+// The count is latched with the SSI read, so that both belong to
+// the same sample, and turned into a position later in the cycle.
+// The trigger interrupt takes its own reading of the count, at the
+// edge, and leaves the main loop's latched count alone.
+// The quadrature output (quad-out.c) uses CLC3, CLC4, Timer3 and
+// Timer4 too, so the two are not used together.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "clock.h"
+#include "quad-in.h"
+
+// Source codes, from the data sheet tables for CLCxSELy and TxCLK.
+#define CLC_IN_CLCIN2 2
+#define CLC_IN_CLCIN3 3
+#define CLC_IN_TMR4 13 // TMR4_postscaled
+#define CLC_IN_CLC3 0x22
+#define CLC_IN_CLC4 0x23
+#define CLC_IN_CLC5 0x24
+#define CLC_IN_CLC6 0x25
+#define TMR_CS_CLC7 0b1101
+#define TMR_CS_CLC8 0b1110
+
+#define CLC_MODE_AND4 0b010 // 4-input AND
+#define CLC_MODE_DFF 0b100 // 1-input D flip-flop with S and R
+#define CLC_GLS_D1T 0x02
+#define CLC_GLS_D2T 0x08
+
+static volatile uint16_t up_high = 0, down_high = 0; // timer overflows
+static int32_t latched_count = 0;
+static int32_t last_count = 0;
+static int32_t counts_per_rev = 4;
+static int32_t position = 0; // 0 .. counts_per_rev-1
+static uint8_t active = 0; // Timer3 may otherwise be quad-out.c's.
+
+void quad_in_init(uint16_t lines)
+{
+    quad_in_close();
+    if (lines < 1) { lines = 1; }
+    if (lines > 16383) { lines = 16383; }
+    counts_per_rev = (int32_t)lines * 4;
+    ANSELBbits.ANSELB6 = 0; TRISBbits.TRISB6 = 1; WPUBbits.WPUB6 = 1; // A
+    ANSELBbits.ANSELB7 = 0; TRISBbits.TRISB7 = 1; WPUBbits.WPUB7 = 1; // B
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    CLCIN2PPS = 0b01110; // RB6
+    CLCIN3PPS = 0b01111; // RB7
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+    // The sample clock.
+    T4HLT = 0; // Free-running mode with software gate.
+    T4CLKCONbits.CS = 0b0001; // FOSC/4
+    T4CONbits.CKPS = 0; // 1:1
+    T4CONbits.OUTPS = 0; // 1:1
+    T4PR = QUAD_IN_SAMPLE_PR;
+    T4TMR = 0;
+    // The flip-flops: gate 1 is the clock (Timer4) and gate 2 the
+    // D input; reset and set have nothing selected.
+    CLC3SEL0 = CLC_IN_TMR4; CLC3SEL1 = CLC_IN_CLCIN2; // A1
+    CLC4SEL0 = CLC_IN_TMR4; CLC4SEL1 = CLC_IN_CLCIN3; // B1
+    CLC5SEL0 = CLC_IN_TMR4; CLC5SEL1 = CLC_IN_CLC3; // A2
+    CLC6SEL0 = CLC_IN_TMR4; CLC6SEL1 = CLC_IN_CLC4; // B2
+    CLC3GLS0 = CLC_GLS_D1T; CLC3GLS1 = CLC_GLS_D2T; CLC3GLS2 = 0; CLC3GLS3 = 0;
+    CLC4GLS0 = CLC_GLS_D1T; CLC4GLS1 = CLC_GLS_D2T; CLC4GLS2 = 0; CLC4GLS3 = 0;
+    CLC5GLS0 = CLC_GLS_D1T; CLC5GLS1 = CLC_GLS_D2T; CLC5GLS2 = 0; CLC5GLS3 = 0;
+    CLC6GLS0 = CLC_GLS_D1T; CLC6GLS1 = CLC_GLS_D2T; CLC6GLS2 = 0; CLC6GLS3 = 0;
+    CLC3POL = 0; CLC4POL = 0; CLC5POL = 0; CLC6POL = 0;
+    CLC3CON = 0x80 | CLC_MODE_DFF;
+    CLC4CON = 0x80 | CLC_MODE_DFF;
+    CLC5CON = 0x80 | CLC_MODE_DFF;
+    CLC6CON = 0x80 | CLC_MODE_DFF;
+    // Data inputs 1-4 are A1, B2, A2, B1 for both pulse outputs.
+    // Gate bits: D1N 0x01, D1T 0x02, D2N 0x04, D2T 0x08, and so on.
+    CLC7SEL0 = CLC_IN_CLC3; CLC7SEL1 = CLC_IN_CLC6;
+    CLC7SEL2 = CLC_IN_CLC5; CLC7SEL3 = CLC_IN_CLC4;
+    CLC7GLS0 = 0x0a; // A1 or B2
+    CLC7GLS1 = 0x05; // !A1 or !B2
+    CLC7GLS2 = 0x60; // A2 or !B1
+    CLC7GLS3 = 0x90; // !A2 or B1
+    CLC7POL = 0;
+    CLC7CON = 0x80 | CLC_MODE_AND4;
+    CLC8SEL0 = CLC_IN_CLC3; CLC8SEL1 = CLC_IN_CLC6;
+    CLC8SEL2 = CLC_IN_CLC5; CLC8SEL3 = CLC_IN_CLC4;
+    CLC8GLS0 = 0xa0; // A2 or B1
+    CLC8GLS1 = 0x50; // !A2 or !B1
+    CLC8GLS2 = 0x06; // A1 or !B2
+    CLC8GLS3 = 0x09; // !A1 or B2
+    CLC8POL = 0;
+    CLC8CON = 0x80 | CLC_MODE_AND4;
+    // Timer3 counts up pulses and Timer5 down pulses.
+    T3CLKbits.CS = TMR_CS_CLC7;
+    T5CLKbits.CS = TMR_CS_CLC8;
+    T3CONbits.CKPS = 0; T5CONbits.CKPS = 0; // 1:1
+    T3CONbits.nSYNC = 0; T5CONbits.nSYNC = 0;
+    T3CONbits.RD16 = 1; T5CONbits.RD16 = 1;
+    T3GCONbits.GE = 0; T5GCONbits.GE = 0;
+    TMR3 = 0; TMR5 = 0;
+    up_high = 0; down_high = 0;
+    latched_count = 0; last_count = 0; position = 0;
+    PIR4bits.TMR3IF = 0; PIR4bits.TMR5IF = 0;
+    PIE4bits.TMR3IE = 1; PIE4bits.TMR5IE = 1;
+    T3CONbits.ON = 1; T5CONbits.ON = 1;
+    T4CONbits.ON = 1;
+    active = 1;
+}
+
+void quad_in_close(void)
+{
+    active = 0;
+    T4CONbits.ON = 0;
+    T3CONbits.ON = 0; T5CONbits.ON = 0;
+    PIE4bits.TMR3IE = 0; PIE4bits.TMR5IE = 0;
+    PIR4bits.TMR3IF = 0; PIR4bits.TMR5IF = 0;
+    CLC3CON = 0; CLC4CON = 0; CLC5CON = 0;
+    CLC6CON = 0; CLC7CON = 0; CLC8CON = 0;
+}
+
+void quad_in_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    if (!active) return;
+    if (PIE4bits.TMR3IE && PIR4bits.TMR3IF) {
+        PIR4bits.TMR3IF = 0;
+        up_high++;
+    }
+    if (PIE4bits.TMR5IE && PIR4bits.TMR5IF) {
+        PIR4bits.TMR5IF = 0;
+        down_high++;
+    }
+}
+
+static int32_t read_count(void)
+{
+    // The count, up less down, as it stands now.
+    uint16_t up, down;
+    uint32_t up_hi, down_hi;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    up = TMR3;
+    down = TMR5;
+    up_hi = up_high;
+    down_hi = down_high;
+    // As in timestamp_now(), an overflow not yet serviced
+    // belongs to this reading only if the low bits have wrapped.
+    if (PIR4bits.TMR3IF && (up < 0x8000)) { up_hi++; }
+    if (PIR4bits.TMR5IF && (down < 0x8000)) { down_hi++; }
+    INTCONbits.GIE = GIEBitValue;
+    return (int32_t)(((up_hi << 16) | up) - ((down_hi << 16) | down));
+}
+
+static uint16_t scale(int32_t pos, uint8_t nbits)
+{
+    return (uint16_t)(((uint32_t)pos << nbits) / (uint32_t)counts_per_rev);
+}
+
+void quad_in_latch(void)
+{
+    // Take the count as it stands now.
+    // Meant to go with the SSI read, where interrupts are held off.
+    latched_count = read_count();
+}
+
+int32_t quad_in_get_count(void) { return latched_count; }
+
+int32_t quad_in_count_now(void)
+// For the trigger interrupt, to be taken with its SSI read.
+{
+    return read_count();
+}
+
+uint16_t quad_in_count_position(int32_t count, uint8_t nbits)
+// A count from quad_in_count_now() as a position, scaled as by
+// quad_in_position().  Both count from 0 at quad_in_init(), so the
+// position is the count modulo the counts per turn.
+{
+    int32_t pos = count % counts_per_rev;
+    if (pos < 0) { pos += counts_per_rev; }
+    return scale(pos, nbits);
+}
+
+uint16_t quad_in_position(uint8_t nbits)
+// The latched count as a position within the turn, scaled to
+// 2^nbits per turn, so that it can stand in for an absolute encoder.
+{
+    int32_t delta = latched_count - last_count;
+    last_count = latched_count;
+    // More than a turn per cycle is possible at speed;
+    // only then do we need the division.
+    if (delta >= counts_per_rev || delta <= -counts_per_rev) { delta %= counts_per_rev; }
+    position += delta;
+    if (position >= counts_per_rev) { position -= counts_per_rev; }
+    if (position < 0) { position += counts_per_rev; }
+    return scale(position, nbits);
+}
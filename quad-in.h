@@ -0,0 +1,19 @@
+// quad-in.h
+// PJ, 2026-10-18
+
+#ifndef MY_QUAD_IN
+#define MY_QUAD_IN
+
+#include <xc.h>
+#include <stdint.h>
+
+void quad_in_init(uint16_t lines);
+void quad_in_close(void);
+void quad_in_service_irq(void);
+void quad_in_latch(void);
+int32_t quad_in_get_count(void);
+uint16_t quad_in_position(uint8_t nbits);
+int32_t quad_in_count_now(void);
+uint16_t quad_in_count_position(int32_t count, uint8_t nbits);
+
+#endif
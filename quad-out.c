@@ -0,0 +1,313 @@
+// quad-out.c
+// Incremental (A/B/Z quadrature) output, emulated from the absolute
+// angle of one channel, for controllers that take only quadrature.
+//   A  RB0  CLC1 output
+//   B  RB1  CLC2 output
+//   Z  RB3  high while the count is at the reference position
+// The pins are those of the MAX7219 display, which must be off.
+//
+// CLC1 and CLC2 are D flip-flops, clocked together, that form a
+// two-stage Johnson counter: going forward, A takes !B and B takes A,
+// so (A,B) runs 00, 10, 11, 01; going back, A takes B and B takes !A.
+// The direction is set by the polarity of each D input.
+// Each cell takes the other's output directly as its D input, within
+// the CLC block, as quad-in.c does; there is no loop-back through the
+// pins (CLCIN0 and CLCIN1 cannot be mapped to PORTB).
+//
+// The steps are made and counted in hardware, with no interrupt per step:
+//   Timer4  one pulse per step period
+//   CLC3    step clock, Timer4 pulse AND run
+//   CLC4    run, an SR latch, set by software and reset by Timer3
+//   Timer3  counts the step clock from 65536-n, so that it overflows,
+//           and stops the steps, at the n-th step
+// The Timer3 interrupt comes only at the end of each run of steps,
+// and a late one delays the next run but loses no steps.
+// quad-in.c uses these CLCs and timers too, so the two cannot be
+// used together.
+//
+// Each new angle sets a target count, with lines*4 counts per turn
+// and the reference at 0.  The steps to it, the short way round, are
+// spread evenly over most of the cycle, no closer than
+// QUAD_OUT_MIN_STEP_US.  The number of lines is limited, by
+// quad_out_max_lines(), so that the largest move, half a turn, fits
+// in the cycle at that spacing; the output then keeps up with any
+// speed that the absolute encoder can be followed at.
+// A move that passes the reference is made as separate runs, to the
+// reference, one step on, and the rest, so that the Z output, set in
+// software, is high for the step at the reference.  Only Z shows the
+// interrupt latency.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "clock.h"
+#include "quad-out.h"
+
+#define Z_OUT LATBbits.LATB3
+#define CLC_MODE_ANDOR 0b000 // (gate 1 and gate 2) or (gate 3 and gate 4)
+#define CLC_MODE_SR 0b011 // SR latch, set by gates 1 or 2, reset by 3 or 4
+#define CLC_MODE_DFF 0b100 // 1-input D flip-flop with S and R
+// Source codes, from the data sheet tables for CLCxSELy and TxCLK.
+#define CLC_IN_TMR3 12 // TMR3 overflow
+#define CLC_IN_TMR4 13 // TMR4_postscaled
+#define CLC_IN_CLC1 0x20
+#define CLC_IN_CLC2 0x21
+#define CLC_IN_CLC3 0x22
+#define CLC_IN_CLC4 0x23
+#define TMR_CS_CLC3 0b1001
+#define CLC_GLS_D1T 0x02
+#define CLC_GLS_D2T 0x08
+#define CLC_GLS_D3T 0x20
+#define CLC_G1POL 0x01
+#define CLC_G2POL 0x02
+#define CLC_G4POL 0x08
+
+static uint16_t counts_per_rev = 4;
+static uint8_t offset_bits = 12;
+static uint32_t spread_us = 37500;
+static volatile uint16_t position = 0; // 0 .. counts_per_rev-1, at the start of the run
+static volatile uint16_t run_steps = 0; // in the run now being made, 0 for none
+static volatile uint16_t remaining = 0; // steps after this run
+static volatile uint8_t going_up = 1;
+
+// Johnson-counter state, from pins (A<<1 | B), to count modulo 4.
+static const uint8_t state_count[4] = {0, 3, 1, 2};
+
+static void set_direction(uint8_t up)
+{
+    CLC1POL = (up) ? CLC_G2POL : 0; // A takes !B going up, B going down.
+    CLC2POL = (up) ? 0 : CLC_G2POL; // B takes A going up, !A going down.
+    going_up = up;
+}
+
+static uint16_t steps_done(void)
+// Steps made so far in this run.  Timer3 started at 65536-run_steps
+// and stops at 0, when the run is complete.
+{
+    if (run_steps == 0) return 0;
+    return (uint16_t)(TMR3 + run_steps);
+}
+
+static uint16_t moved_on(uint16_t moved)
+// The position at the start of the run, moved on by some steps.
+{
+    uint16_t p = position;
+    if (going_up) {
+        p += moved;
+        if (p >= counts_per_rev) { p -= counts_per_rev; }
+    } else {
+        p = (p < moved) ? p + counts_per_rev - moved : p - moved;
+    }
+    return p;
+}
+
+static void stop_run(void)
+{
+    // Reset the run latch by forcing gate 4 high for a moment.
+    CLC4POL = CLC_G4POL;
+    CLC4POL = 0;
+    run_steps = 0;
+    PIR4bits.TMR3IF = 0;
+}
+
+static void next_run(void)
+// From the position at the end of a run, start the next,
+// stopping at the reference so that Z can be shown there.
+{
+    uint16_t n;
+    Z_OUT = (position == 0);
+    if (remaining == 0) {
+        T4CONbits.ON = 0;
+        return;
+    }
+    if (position == 0) {
+        n = 1;
+    } else {
+        n = (going_up) ? counts_per_rev - position : position;
+        if (n > remaining) { n = remaining; }
+    }
+    remaining -= n;
+    run_steps = n;
+    TMR3 = (uint16_t)(0 - n);
+    PIR4bits.TMR3IF = 0;
+    // Set the run latch by forcing gate 1 high for a moment.
+    CLC4POL = CLC_G1POL;
+    CLC4POL = 0;
+}
+
+void quad_out_init(uint16_t lines, uint8_t nbits, uint32_t cycle_us)
+// lines: per revolution, up to 16383.
+// nbits: resolution of the offsets given to quad_out_update().
+{
+    quad_out_close();
+    if (lines < 1) { lines = 1; }
+    if (lines > 16383) { lines = 16383; }
+    counts_per_rev = lines * 4;
+    offset_bits = nbits;
+    quad_out_set_cycle(cycle_us);
+    ANSELBbits.ANSELB0 = 0; TRISBbits.TRISB0 = 0; // A
+    ANSELBbits.ANSELB1 = 0; TRISBbits.TRISB1 = 0; // B
+    ANSELBbits.ANSELB3 = 0; TRISBbits.TRISB3 = 0; Z_OUT = 0; // Z
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    RB0PPS = 0x01; // CLC1OUT
+    RB1PPS = 0x02; // CLC2OUT
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+    // The run latch: gate 3, the Timer3 overflow, resets it; the
+    // others have nothing selected and are only forced high by
+    // their polarity bits, gate 1 to set it and gate 4 to reset it.
+    CLC4SEL0 = 0; CLC4SEL1 = 0; CLC4SEL2 = CLC_IN_TMR3; CLC4SEL3 = 0;
+    CLC4GLS0 = 0; CLC4GLS1 = 0; CLC4GLS2 = CLC_GLS_D3T; CLC4GLS3 = 0;
+    CLC4POL = 0;
+    CLC4CON = 0x80 | CLC_MODE_SR;
+    // The step clock: Timer4 pulses, let through while running.
+    CLC3SEL0 = CLC_IN_TMR4; CLC3SEL1 = CLC_IN_CLC4;
+    CLC3SEL2 = 0; CLC3SEL3 = 0;
+    CLC3GLS0 = CLC_GLS_D1T; CLC3GLS1 = CLC_GLS_D2T;
+    CLC3GLS2 = 0; CLC3GLS3 = 0;
+    CLC3POL = 0;
+    CLC3CON = 0x80 | CLC_MODE_ANDOR;
+    // The Johnson counter: gate 1 is the clock and gate 2 the D input;
+    // gates 3 and 4, reset and set, have nothing selected and are low.
+    CLC1SEL0 = CLC_IN_CLC3; CLC1SEL1 = CLC_IN_CLC2; // A follows B
+    CLC1SEL2 = 0; CLC1SEL3 = 0;
+    CLC1GLS0 = CLC_GLS_D1T; CLC1GLS1 = CLC_GLS_D2T;
+    CLC1GLS2 = 0; CLC1GLS3 = 0;
+    CLC2SEL0 = CLC_IN_CLC3; CLC2SEL1 = CLC_IN_CLC1; // B follows A
+    CLC2SEL2 = 0; CLC2SEL3 = 0;
+    CLC2GLS0 = CLC_GLS_D1T; CLC2GLS1 = CLC_GLS_D2T;
+    CLC2GLS2 = 0; CLC2GLS3 = 0;
+    set_direction(1);
+    CLC1CON = 0x80 | CLC_MODE_DFF;
+    CLC2CON = 0x80 | CLC_MODE_DFF;
+    // Timer4 ticks each microsecond; its period is set for each move.
+    T4HLT = 0; // Free-running mode with software gate.
+    T4CLKCONbits.CS = 0b0001; // FOSC/4
+    T4CONbits.CKPS = TIMER4_CKPS_1US;
+    // Timer3 counts the step clock, whose pulses are a Timer4 tick wide,
+    // synchronised to the system clock.
+    T3CLKbits.CS = TMR_CS_CLC3;
+    T3CONbits.CKPS = 0; // 1:1
+    T3CONbits.nSYNC = 0;
+    T3CONbits.RD16 = 1;
+    T3GCONbits.GE = 0;
+    TMR3 = 0;
+    position = state_count[(PORTBbits.RB0 << 1) | PORTBbits.RB1];
+    run_steps = 0;
+    remaining = 0;
+    Z_OUT = (position == 0);
+    PIR4bits.TMR3IF = 0;
+    PIE4bits.TMR3IE = 1;
+    T3CONbits.ON = 1;
+}
+
+void quad_out_close(void)
+{
+    T4CONbits.ON = 0;
+    T3CONbits.ON = 0;
+    PIE4bits.TMR3IE = 0;
+    PIR4bits.TMR3IF = 0;
+    CLC1CON = 0;
+    CLC2CON = 0;
+    CLC3CON = 0;
+    CLC4CON = 0;
+    run_steps = 0;
+    remaining = 0;
+    // Hand RB0 and RB1 back to their latches, for the LED display.
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    RB0PPS = 0;
+    RB1PPS = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+}
+
+void quad_out_set_cycle(uint32_t cycle_us)
+// For a new cycle period: the moves are spread over the new cycle,
+// leaving the count as it is.
+{
+    spread_us = cycle_us / 100 * QUAD_OUT_SPREAD_PERCENT;
+}
+
+uint16_t quad_out_max_lines(uint32_t cycle_us)
+// The most lines per turn for which half a turn of steps,
+// at the closest spacing, fits in the part of the cycle we use.
+{
+    uint32_t lines = cycle_us / 100 * QUAD_OUT_SPREAD_PERCENT / (2 * QUAD_OUT_MIN_STEP_US);
+    return (lines > 16383) ? 16383 : (uint16_t)lines;
+}
+
+void quad_out_update(uint16_t offset)
+// offset: the channel's angle from its reference, in nbits.
+{
+    uint16_t target;
+    uint16_t total;
+    int32_t delta;
+    uint32_t spacing;
+    uint8_t postscale;
+    offset &= (uint16_t)((1UL << offset_bits) - 1);
+    target = (uint16_t)(((uint32_t)offset * counts_per_rev) >> offset_bits);
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    // Stop where we are, part way through a move or not.
+    T4CONbits.ON = 0;
+    position = moved_on(steps_done());
+    stop_run();
+    remaining = 0;
+    delta = (int32_t)target - (int32_t)position;
+    if (delta > (int32_t)(counts_per_rev / 2)) { delta -= counts_per_rev; }
+    if (delta < -(int32_t)(counts_per_rev / 2)) { delta += counts_per_rev; }
+    if (delta != 0) {
+        set_direction(delta > 0);
+        total = (uint16_t)((delta > 0) ? delta : -delta);
+        spacing = spread_us / total;
+        if (spacing < QUAD_OUT_MIN_STEP_US) { spacing = QUAD_OUT_MIN_STEP_US; }
+        // Period of (PR+1) ticks times the postscale.
+        postscale = (uint8_t)((spacing + 255) / 256);
+        if (postscale > 16) { postscale = 16; }
+        spacing /= postscale;
+        if (spacing > 256) { spacing = 256; }
+        T4CONbits.OUTPS = (uint8_t)(postscale - 1);
+        T4PR = (uint8_t)(spacing - 1);
+        T4TMR = 0;
+        remaining = total;
+        next_run();
+        T4CONbits.ON = 1;
+    } else {
+        Z_OUT = (position == 0);
+    }
+    INTCONbits.GIE = GIEBitValue;
+}
+
+void quad_out_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    // Timer3 has overflowed at the last step of a run, and the run
+    // latch has stopped the steps.
+    if (!(PIE4bits.TMR3IE && PIR4bits.TMR3IF && run_steps)) return;
+    position = moved_on(run_steps);
+    stop_run();
+    next_run();
+}
+
+uint16_t quad_out_get_position(void)
+{
+    uint16_t p;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    p = moved_on(steps_done());
+    INTCONbits.GIE = GIEBitValue;
+    return p;
+}
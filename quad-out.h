@@ -0,0 +1,26 @@
+// quad-out.h
+// PJ, 2026-10-18
+
+#ifndef MY_QUAD_OUT
+#define MY_QUAD_OUT
+
+#include <xc.h>
+#include <stdint.h>
+
+// Closest spacing of the output steps.  The steps are counted in
+// hardware (see quad-out.c), so this is set by what the controller
+// reading them can take rather than by interrupt latency.
+#define QUAD_OUT_MIN_STEP_US 1
+// The steps for each new angle are spread over this part of the cycle,
+// so that they are finished before the next angle arrives.
+#define QUAD_OUT_SPREAD_PERCENT 75
+
+void quad_out_init(uint16_t lines, uint8_t nbits, uint32_t cycle_us);
+void quad_out_close(void);
+uint16_t quad_out_max_lines(uint32_t cycle_us);
+void quad_out_set_cycle(uint32_t cycle_us);
+void quad_out_update(uint16_t offset);
+void quad_out_service_irq(void);
+uint16_t quad_out_get_position(void);
+
+#endif
@@ -3,10 +3,13 @@
 // to send data to a max7219 display driver and its 8 7-segment digits.
 //
 // PJ, 2023-03-07
+//     2026-10-18 SPI clock derived from FOSC.
+//                Display can be closed, and opened again, while running.
 //
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include <stdint.h>
 #include "spi-max7219.h"
 
@@ -19,6 +22,7 @@ void spi2_init(void)
     ANSELBbits.ANSELB3 = 0; TRISBbits.TRISB3 = 0; LATBbits.LATB3 = 0; // SDO2
     ANSELBbits.ANSELB0 = 0; TRISBbits.TRISB0 = 0; CSn = 1; // CSn
     // Configure SPI2 peripheral device.
+    uint8_t GIEBitValue = INTCONbits.GIE;
     GIE = 0;
     PPSLOCK = 0x55;
     PPSLOCK = 0xaa;
@@ -30,14 +34,35 @@ void spi2_init(void)
     PPSLOCK = 0x55;
     PPSLOCK = 0xaa;
     PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
     //
     SSP2STATbits.SMP = 0; // Sample in middle of data output time
     SSP2STATbits.CKE = 1; // Transmit data on active to idle level of clock
     SSP2CON1bits.CKP = 0; // Clock idles low
-    SSP2CON1bits.SSPM = 0b0010; // Mode is master, clock is FOSC/64
+    SSP2ADD = SPI2_SSPADD; // 500kHz, for any FOSC
+    SSP2CON1bits.SSPM = 0b1010; // Mode is master, clock is FOSC/(4*(SSP2ADD+1))
     SSP2CON1bits.SSPEN = 1; // Enable
 }
 
+void spi2_close(void)
+{
+    // Blank the display and give the pins back to their latches,
+    // for the quadrature and analog outputs.
+    spi2_write(0x0c, 0x00); // shutdown register: shutdown mode
+    SSP2CON1bits.SSPEN = 0;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    RB1PPS = 0;
+    RB3PPS = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    INTCONbits.GIE = GIEBitValue;
+}
+
 void spi2_write(uint8_t addr, uint8_t data)
 {
     unsigned char dummy;
@@ -5,6 +5,7 @@
 #define SPI_MAX7219
 
 void spi2_init(void);
+void spi2_close(void);
 void spi2_write(uint8_t addr, uint8_t data);
 void max7219_init(void);
 void spi2_led_display_unsigned(uint16_t a, uint16_t b);
@@ -0,0 +1,81 @@
+// stats.c
+// Health counters for the readout, reported on request as one line:
+//   S,samples,overruns,i2c_timeout,i2c_wcol,i2c_bcl,ssi_a,ssi_b,
+//     uart_drops,trigger_drops,eeprom_writes,wdt_resets,magnet,
+//     as5600_pwm,i2c_skipped,i2c_recoveries
+// The count of watchdog resets is kept in EEPROM so that it survives
+// the resets that it counts.
+//
+// The AEAT and AS36 SSI frames have no parity bit and every value
+// is in range, so the SSI counters record the one fault that we can
+// see: a data line stuck high (the inputs have weak pull-ups, so an
+// unplugged encoder reads as all ones) on successive samples.
+//
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "global_defs.h"
+#include "eeprom.h"
+#include "uart.h"
+#include "trigger.h"
+#include "i2c.h"
+#include "stats.h"
+
+static uint32_t counters[STATS_N];
+static uint16_t wdt_resets;
+static uint8_t ones_a = 0, ones_b = 0;
+
+void stats_init(void)
+{
+    stats_clear();
+    wdt_resets = (uint16_t) (DATAEE_ReadByte(EE_ADDR_WDT_RESETS+1) << 8) |
+        DATAEE_ReadByte(EE_ADDR_WDT_RESETS);
+    if (wdt_resets == 0xffff) { wdt_resets = 0; } // freshly-programmed chip
+    if (PCON0bits.nRWDT == 0) {
+        // We have arrived here via a watchdog reset.
+        wdt_resets++;
+        DATAEE_WriteByte(EE_ADDR_WDT_RESETS, (uint8_t)(wdt_resets & 0xff));
+        DATAEE_WriteByte(EE_ADDR_WDT_RESETS+1, (uint8_t)(wdt_resets >> 8));
+        PCON0bits.nRWDT = 1;
+    }
+}
+
+void stats_clear(void)
+{
+    for (uint8_t i=0; i < STATS_N; ++i) { counters[i] = 0; }
+}
+
+void stats_count(uint8_t which)
+{
+    if (which < STATS_N) { counters[which]++; }
+}
+
+void stats_count_i2c_error(uint8_t code)
+{
+    // Codes as set by i2c1_read() and i2c1_write(); 0 is no error.
+    if (code >= 1 && code <= 3) { counters[STATS_I2C_TIMEOUT + code - 1]++; }
+    if (code == 4) { counters[STATS_I2C_SKIPPED]++; }
+}
+
+void stats_check_ssi(uint16_t a, uint16_t b, uint16_t mask_a, uint16_t mask_b)
+{
+    ones_a = (a == mask_a) ? ones_a + 1 : 0;
+    ones_b = (b == mask_b) ? ones_b + 1 : 0;
+    if (ones_a >= 2) { counters[STATS_SSI_A]++; ones_a = 1; }
+    if (ones_b >= 2) { counters[STATS_SSI_B]++; ones_b = 1; }
+}
+
+void stats_report(void)
+{
+    uint16_t uart_drops = uart1_get_rx_dropped();
+    uint16_t trigger_drops = trigger_get_dropped();
+    printf("S,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%u,%u,%u,%u,%lu,%lu,%lu,%u\r\n",
+           counters[STATS_SAMPLES], counters[STATS_OVERRUNS],
+           counters[STATS_I2C_TIMEOUT], counters[STATS_I2C_WCOL], counters[STATS_I2C_BCL],
+           counters[STATS_SSI_A], counters[STATS_SSI_B],
+           uart_drops, trigger_drops, DATAEE_GetWriteCount(), wdt_resets,
+           counters[STATS_MAGNET], counters[STATS_AS5600_PWM],
+           counters[STATS_I2C_SKIPPED], i2c1_get_recoveries());
+}
@@ -0,0 +1,29 @@
+// stats.h
+// PJ, 2026-10-18
+
+#ifndef MY_STATS
+#define MY_STATS
+
+#include <stdint.h>
+
+// Counters kept in RAM.
+#define STATS_SAMPLES 0
+#define STATS_OVERRUNS 1
+#define STATS_I2C_TIMEOUT 2 // i2c1 error code 1
+#define STATS_I2C_WCOL 3 // i2c1 error code 2
+#define STATS_I2C_BCL 4 // i2c1 error code 3
+#define STATS_SSI_A 5 // stuck data line on channel A
+#define STATS_SSI_B 6
+#define STATS_MAGNET 7 // AS5600 angle not used: no magnet, too weak or too strong
+#define STATS_AS5600_PWM 8 // no good AS5600 PWM frame since the previous sample
+#define STATS_I2C_SKIPPED 9 // i2c1 error code 4
+#define STATS_N 10
+
+void stats_init(void);
+void stats_clear(void);
+void stats_count(uint8_t which);
+void stats_count_i2c_error(uint8_t code);
+void stats_check_ssi(uint16_t a, uint16_t b, uint16_t mask_a, uint16_t mask_b);
+void stats_report(void);
+
+#endif
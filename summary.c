@@ -0,0 +1,114 @@
+// summary.c
+// Windowed statistics of each channel's angle, for soak tests where
+// the link need carry only a summary line every second or so:
+//   G,n,a_min,a_max,a_mean,a_sd,b_min,b_max,b_mean,b_sd
+// with the angles in 1/100 degree, over the n samples of the window.
+//
+// Every sample goes into the sums, so nothing between the summaries
+// is missed.  Angles are taken relative to the first sample of the
+// window, the short way round, so that a shaft sitting at 180 degrees
+// gives a mean of 180 and a small deviation rather than a mean of 0;
+// the minimum, maximum and mean are wrapped back to +/-180 degrees
+// for the report.  Sums of squares are kept to 64 bits, which holds
+// a window of 65535 samples at the largest deviation.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "summary.h"
+
+typedef struct {
+    int16_t first;
+    int16_t min, max; // relative to first
+    int32_t sum;
+    uint64_t sum_sq;
+} channel_sums_t;
+
+static uint16_t interval = 0; // samples per window; 0 for off
+static uint16_t count = 0;
+static channel_sums_t sums[2];
+
+void summary_set_interval(uint16_t nsamples)
+{
+    interval = nsamples;
+    count = 0;
+}
+
+uint16_t summary_get_interval(void) { return interval; }
+
+uint16_t summary_cycles(uint16_t seconds, uint32_t cycle_us)
+// A window of so many seconds, as the nearest number of cycles.
+{
+    uint32_t n = ((uint32_t)seconds * 1000000UL + cycle_us/2) / cycle_us;
+    return (n > 0xffff) ? 0xffff : (uint16_t)n;
+}
+
+static int16_t wrap(int32_t x)
+{
+    if (x > 18000) { x -= 36000; }
+    if (x < -18000) { x += 36000; }
+    return (int16_t)x;
+}
+
+static void add(channel_sums_t* s, int16_t v)
+{
+    int16_t d;
+    if (count == 0) {
+        s->first = v;
+        s->min = 0; s->max = 0;
+        s->sum = 0; s->sum_sq = 0;
+    }
+    d = wrap((int32_t)v - s->first);
+    if (d < s->min) { s->min = d; }
+    if (d > s->max) { s->max = d; }
+    s->sum += d;
+    s->sum_sq += (uint64_t)((int32_t)d * d);
+}
+
+uint8_t summary_add(int16_t a_cdeg, int16_t b_cdeg)
+// Returns 1 when a window is complete and its summary is due.
+{
+    if (interval == 0) return 0;
+    add(&sums[0], a_cdeg);
+    add(&sums[1], b_cdeg);
+    count++;
+    return (count >= interval);
+}
+
+static uint16_t isqrt32(uint32_t x)
+{
+    uint32_t root = 0, bit = 1UL << 30;
+    while (bit > x) { bit >>= 2; }
+    while (bit) {
+        if (x >= root + bit) {
+            x -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+static void report_channel(channel_sums_t* s)
+{
+    // Variance as (n*sum_sq - sum^2)/n^2, in 64 bits.
+    int32_t mean = (s->sum >= 0) ? (s->sum + count/2) / count : (s->sum - count/2) / count;
+    int64_t sq = (int64_t)s->sum * s->sum;
+    uint64_t nvar = (uint64_t)count * s->sum_sq - (uint64_t)sq;
+    uint32_t var = (uint32_t)(nvar / ((uint64_t)count * count));
+    printf(",%d,%d,%d,%u", wrap((int32_t)s->first + s->min), wrap((int32_t)s->first + s->max),
+           wrap((int32_t)s->first + mean), isqrt32(var));
+}
+
+void summary_report(void)
+{
+    if (count == 0) return;
+    printf("G,%u", count);
+    report_channel(&sums[0]);
+    report_channel(&sums[1]);
+    printf("\r\n");
+    count = 0;
+}
@@ -0,0 +1,15 @@
+// summary.h
+// PJ, 2026-10-18
+
+#ifndef MY_SUMMARY
+#define MY_SUMMARY
+
+#include <stdint.h>
+
+void summary_set_interval(uint16_t nsamples);
+uint16_t summary_get_interval(void);
+uint16_t summary_cycles(uint16_t seconds, uint32_t cycle_us);
+uint8_t summary_add(int16_t a_cdeg, int16_t b_cdeg);
+void summary_report(void);
+
+#endif
@@ -3,12 +3,39 @@
 //     2019-04-22 Adapted to PIC16F18426.
 //     2023-02-04 Adapted to allow up to 8 second period.
 //                No other changes needed for PIC18F26Q10.
+//     2026-10-18 Wait in Idle or Doze mode, woken by the TMR2 interrupt.
+//                Period can be changed while running.
+//                An idle task, run each time the wait wakes.
+//
+// Wake-up latency, measured from TMR2IF being set:
+//   SPIN  the polling loop, up to about 1us, as before.
+//   IDLE  the CPU clock is stopped but the oscillator keeps running,
+//         so there is no start-up delay.  Waking takes 2-3 instruction
+//         cycles and, with interrupts enabled, timer2_service_irq()
+//         runs before we continue, about 12us at FOSC=32MHz.
+//         That delay is much the same every cycle, so the sampling
+//         instant is shifted rather than jittered, except when
+//         another interrupt is being serviced at the time.
+//   DOZE  the CPU runs at 1/32 speed while polling and returns to
+//         full speed on the interrupt; the delay is as for IDLE
+//         plus, at worst, one pass of the polling loop at reduced
+//         speed, about 16us at FOSC=32MHz.
+// The GREENLED slack signal in the mains shows this on an oscilloscope.
+//
+// The idle task, if set, runs at full speed each time the wait is
+// woken by an interrupt (or, for SPIN, on every pass), so that work
+// that an interrupt brings need not wait for the next cycle.
+// It must finish well before the period ends, since the period's
+// end is seen only when it returns.
 
 #include <xc.h>
 #include <stdint.h>
 #include "global_defs.h"
 #include "timer2-free-run.h"
 
+static uint8_t wait_mode = TIMER2_WAIT_SPIN;
+static void (*idle_task)(void) = 0;
+
 void timer2_init(uint8_t count, uint8_t postscale)
 {
     // count (prplus1) is number of ticks that will be counted before reset
@@ -26,16 +53,89 @@ void timer2_init(uint8_t count, uint8_t postscale)
     T2CONbits.ON = 1;
 }
 
+void timer2_set_period(uint8_t count)
+{
+    // Meant to be called just after timer2_wait() returns,
+    // while the count is still below the new period, so that
+    // the cycle that has just started is the first of the new length.
+    if (count < 1) { count = 1; }
+    T2PR = (uint8_t) (count - 1);
+}
+
 void timer2_close(void)
 {
     T2CONbits.ON = 0;
+    PIE4bits.TMR2IE = 0;
     PIR4bits.TMR2IF = 0;
 }
 
-void timer2_wait(void)
+void timer2_set_wait_mode(uint8_t mode)
+{
+    // IDLE and DOZE need the TMR2 interrupt and, if global interrupts
+    // are enabled, a call to timer2_service_irq() in the ISR.
+    wait_mode = (mode <= TIMER2_WAIT_DOZE) ? mode : TIMER2_WAIT_SPIN;
+}
+
+uint8_t timer2_get_wait_mode(void) { return wait_mode; }
+
+void timer2_set_idle_task(void (*task)(void))
+{
+    // 0 for none.
+    idle_task = task;
+}
+
+void timer2_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    // We leave TMR2IF for timer2_wait() to see, so we must
+    // disable the interrupt to avoid coming straight back.
+    if (PIE4bits.TMR2IE && PIR4bits.TMR2IF) {
+        PIE4bits.TMR2IE = 0;
+    }
+}
+
+uint8_t timer2_wait(void)
+// Returns 1 if the period had already ended when we arrived,
+// that is, if the cycle's tasks overran.
 {
-    while (!PIR4bits.TMR2IF) { CLRWDT(); }
+    uint8_t overrun = PIR4bits.TMR2IF;
+    switch (wait_mode) {
+    case TIMER2_WAIT_IDLE:
+        CPUDOZEbits.IDLEN = 1; // SLEEP instruction enters Idle mode.
+        while (!PIR4bits.TMR2IF) {
+            CLRWDT();
+            // Any enabled interrupt will wake us; if TMR2IF has been
+            // set since we looked, SLEEP does not stop the CPU.
+            PIE4bits.TMR2IE = 1;
+            SLEEP();
+            NOP();
+            if (idle_task) { idle_task(); }
+        }
+        CPUDOZEbits.IDLEN = 0;
+        break;
+    case TIMER2_WAIT_DOZE:
+        CPUDOZEbits.DOZE = 0b100; // CPU at 1:32
+        CPUDOZEbits.ROI = 1; // Full speed once an interrupt arrives.
+        CPUDOZEbits.DOE = 0; // and stay at full speed afterwards.
+        while (!PIR4bits.TMR2IF) {
+            CLRWDT();
+            // An interrupt has cleared DOZEN (ROI), so the task
+            // runs at full speed, and only after a wake-up.
+            if (idle_task && !CPUDOZEbits.DOZEN) { idle_task(); }
+            PIE4bits.TMR2IE = 1;
+            CPUDOZEbits.DOZEN = 1;
+        }
+        CPUDOZEbits.DOZEN = 0;
+        break;
+    default:
+        while (!PIR4bits.TMR2IF) {
+            CLRWDT();
+            if (idle_task) { idle_task(); }
+        }
+    }
+    PIE4bits.TMR2IE = 0;
     // We reset the flag but leave the timer ticking
     // so that we have accurate periods.
     PIR4bits.TMR2IF = 0;
+    return overrun;
 }
@@ -1,5 +1,5 @@
 // timer2-free-run.h
-// PJ, 2018-01-20, 2023-02-04
+// PJ, 2018-01-20, 2023-02-04, 2026-10-18
 //
 #ifndef MY_TIMER2_FREE_RUN
 #define MY_TIMER2_FREE_RUN
@@ -7,7 +7,17 @@
 #include <xc.h>
 #include <stdint.h>
 
+// How timer2_wait() passes the slack time.
+#define TIMER2_WAIT_SPIN 0
+#define TIMER2_WAIT_IDLE 1
+#define TIMER2_WAIT_DOZE 2
+
 void timer2_init(uint8_t period_count, uint8_t postscale);
+void timer2_set_period(uint8_t count);
 void timer2_close(void);
-void timer2_wait(void);
+void timer2_set_wait_mode(uint8_t mode);
+uint8_t timer2_get_wait_mode(void);
+void timer2_set_idle_task(void (*task)(void));
+void timer2_service_irq(void);
+uint8_t timer2_wait(void);
 #endif
@@ -0,0 +1,67 @@
+// timestamp.c
+// A free-running microsecond clock built from Timer1 on the PIC18F26Q10.
+// Timer1 supplies the low 16 bits and its overflow interrupt
+// counts the high 16 bits, so the value wraps after about 71 minutes.
+// Timer1 is also the time base for CCP captures (see trigger.c),
+// so a captured 16-bit value can be extended to the full 32 bits.
+// At FOSC=64MHz, Timer1 ticks twice per microsecond and the
+// extra bit is shifted away, leaving 32 bits of microseconds.
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "clock.h"
+#include "timestamp.h"
+
+static volatile uint32_t timestamp_high = 0; // Timer1 overflows
+
+void timestamp_init(void)
+{
+    T1CONbits.ON = 0;
+    T1CLKbits.CS = 0b0001; // FOSC/4
+    T1CONbits.CKPS = 0b11; // 1:8 prescale gives 1us ticks when FOSC=32MHz, 0.5us at 64MHz
+    T1CONbits.RD16 = 1; // Reading TMR1L latches TMR1H.
+    T1GCONbits.GE = 0; // Always counting.
+    TMR1 = 0;
+    timestamp_high = 0;
+    PIR4bits.TMR1IF = 0;
+    PIE4bits.TMR1IE = 1; // Overflows are counted in the interrupt service routine.
+    T1CONbits.ON = 1;
+}
+
+void timestamp_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    if (PIE4bits.TMR1IE && PIR4bits.TMR1IF) {
+        PIR4bits.TMR1IF = 0;
+        timestamp_high++;
+    }
+}
+
+uint32_t timestamp_now(void)
+{
+    uint16_t lo;
+    uint32_t hi;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    lo = TMR1;
+    hi = timestamp_high;
+    // An overflow that has not yet been serviced belongs to this reading
+    // only if the low bits have already wrapped around.
+    if (PIR4bits.TMR1IF && (lo < 0x8000)) { hi++; }
+    INTCONbits.GIE = GIEBitValue;
+    return (hi << (16 - TIMESTAMP_SHIFT)) | (lo >> TIMESTAMP_SHIFT);
+}
+
+uint32_t timestamp_extend(uint16_t ticks, uint32_t later)
+{
+    // Reconstruct the full timestamp of a 16-bit Timer1 capture
+    // that happened less than one Timer1 period (65.5ms at FOSC=32MHz,
+    // 32.7ms at 64MHz) before the time later.
+    uint16_t span_mask = 0xffff >> TIMESTAMP_SHIFT;
+    uint16_t us = ticks >> TIMESTAMP_SHIFT;
+    uint32_t t = (later & ~(uint32_t)span_mask) | us;
+    if (us > ((uint16_t)later & span_mask)) { t -= (uint32_t)span_mask + 1; }
+    return t;
+}
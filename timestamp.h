@@ -0,0 +1,15 @@
+// timestamp.h
+// PJ, 2026-10-18
+
+#ifndef MY_TIMESTAMP
+#define MY_TIMESTAMP
+
+#include <xc.h>
+#include <stdint.h>
+
+void timestamp_init(void);
+void timestamp_service_irq(void);
+uint32_t timestamp_now(void);
+uint32_t timestamp_extend(uint16_t ticks, uint32_t later);
+
+#endif
@@ -0,0 +1,145 @@
+// trigger.c
+// External trigger input on RC0 that latches the encoder positions.
+//
+// The rising edge is timestamped in hardware by CCP1 capturing Timer1,
+// so the recorded edge time has no software jitter.
+// The CCP1 interrupt then reads the encoders and queues a record
+// that the main loop sends out, from its wait or on its next pass.
+//
+// Latency from edge to encoder latch is bounded by:
+// (1) the longest stretch for which interrupts are held off, which is
+//     one SSI frame, whether the main loop's own sample or one frame
+//     of a burst capture (capture.c): about 44us for a 12-bit AEAT
+//     frame and 74us for the AS36 or mixed frame, with its monoflop
+//     time-out, at FOSC=32MHz; 35us and 62us at 64MHz.
+//     EEPROM writes hold interrupts off only for their unlock sequence,
+//     a couple of microseconds; the write itself (about 4ms per byte,
+//     for the push buttons and the L, N and E commands) runs with
+//     interrupts on (eeprom.c).
+// (2) the other handlers in the interrupt service routine, which run
+//     first if their flags are also set, up to about 20us (32MHz) or
+//     10us (64MHz),
+// (3) interrupt entry, context save and reading the timestamp,
+//     about 13us at FOSC=32MHz or 7us at 64MHz, and
+// (4) the start of the SSI frame in the interrupt, well under 1us.
+// That gives a worst case of about 77us (AEAT) or 107us (AS36) at
+// 32MHz, and 52us or 79us at 64MHz.  The least is 13us (32MHz)
+// or 7us (64MHz), when nothing else is going on.
+// host/trigger-latency-sim.cpp models this in more detail.
+// The measured latency is reported with every record.
+// Edges closer together than the interrupt service time (about 60us)
+// will overwrite the CCP1 capture and are seen as one edge.
+//
+// Records are sent by the main loop, once per cycle, and also from
+// the wait for the next cycle (timer2_wait()'s idle task), as soon
+// as they arrive, so long as each T line can be out before the next
+// sample is due.  What is guaranteed not to be dropped is:
+//   burst      TRIGGER_QUEUE_LEN-1 (63) edges, at any spacing above
+//              the interrupt service time, after the queue has drained;
+//   sustained  as many edges as the UART can carry in the slack of
+//              each cycle (W command): a T line is up to 40 characters,
+//              3.5ms at 115200 baud, so a little under 290 per second
+//              of slack, and 8 times that at 921600 baud.
+// Beyond these, the newest records are dropped; the host sees the
+// gap in sequence numbers and trigger_get_dropped() counts them.
+// No queue can hold a faster stream indefinitely, since the UART
+// is the bottleneck.
+//
+// PJ, 2026-10-18
+
+#include <xc.h>
+#include <stdint.h>
+#include "global_defs.h"
+#include "timestamp.h"
+#include "trigger.h"
+
+static trigger_record_t queue[TRIGGER_QUEUE_LEN];
+static volatile uint8_t q_head = 0; // Written only by the ISR.
+static volatile uint8_t q_tail = 0; // Written only by the main loop.
+static volatile uint16_t edge_count = 0;
+static volatile uint16_t dropped = 0;
+static uint16_t edge_ticks;
+
+void trigger_init(void)
+{
+    // Expects timestamp_init() to have set up Timer1.
+    ANSELCbits.ANSELC0 = 0; TRISCbits.TRISC0 = 1; WPUCbits.WPUC0 = 1; // TRIG-IN
+    GIE = 0;
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 0;
+    CCP1PPS = 0b10000; // RC0
+    PPSLOCK = 0x55;
+    PPSLOCK = 0xaa;
+    PPSLOCKED = 1;
+    CCPTMRSbits.C1TSEL = 0b01; // Capture Timer1
+    CCP1CONbits.EN = 0;
+    CCP1CONbits.MODE = 0b0101; // Capture every rising edge
+    q_head = 0; q_tail = 0;
+    edge_count = 0; dropped = 0;
+    PIR6bits.CCP1IF = 0;
+    PIE6bits.CCP1IE = 1;
+    CCP1CONbits.EN = 1;
+}
+
+void trigger_close(void)
+{
+    PIE6bits.CCP1IE = 0;
+    CCP1CONbits.EN = 0;
+    PIR6bits.CCP1IF = 0;
+}
+
+uint8_t trigger_edge_pending(void)
+{
+    // To be called from the interrupt service routine.
+    // If there has been an edge, remember its capture time
+    // so that trigger_push() can complete the record.
+    if (!(PIE6bits.CCP1IE && PIR6bits.CCP1IF)) return 0;
+    edge_ticks = CCPR1;
+    PIR6bits.CCP1IF = 0;
+    return 1;
+}
+
+void trigger_push(uint16_t a, uint16_t b, uint32_t t_latch)
+{
+    // To be called from the interrupt service routine,
+    // after latching the encoders at time t_latch.
+    uint8_t next = (q_head + 1) & (TRIGGER_QUEUE_LEN - 1);
+    edge_count++;
+    if (next == q_tail) {
+        // Queue is full; the gap in sequence numbers will show the host.
+        dropped++;
+        return;
+    }
+    trigger_record_t* rec = &queue[q_head];
+    rec->seq = edge_count;
+    rec->t_edge = timestamp_extend(edge_ticks, t_latch);
+    rec->latency = (uint16_t)(t_latch - rec->t_edge);
+    rec->a = a;
+    rec->b = b;
+    q_head = next;
+}
+
+uint8_t trigger_pop(trigger_record_t* rec)
+{
+    // Returns 1 if a record was copied out of the queue.
+    // Only the ISR moves q_head, and only this function moves q_tail,
+    // so the main loop does not need to hold off interrupts.
+    if (q_tail == q_head) return 0;
+    *rec = queue[q_tail];
+    q_tail = (q_tail + 1) & (TRIGGER_QUEUE_LEN - 1);
+    return 1;
+}
+
+uint16_t trigger_get_dropped(void) { return dropped; }
+
+uint16_t trigger_get_edge_count(void)
+// The number of edges seen so far, for the main loop to watch.
+{
+    uint16_t n;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    n = edge_count;
+    INTCONbits.GIE = GIEBitValue;
+    return n;
+}
@@ -0,0 +1,30 @@
+// trigger.h
+// PJ, 2026-10-18
+
+#ifndef MY_TRIGGER
+#define MY_TRIGGER
+
+#include <xc.h>
+#include <stdint.h>
+
+// Number of latched records, less one, that can be held until they
+// are sent (see trigger.c).  Must be a power of 2.  12 bytes each.
+#define TRIGGER_QUEUE_LEN 64
+
+typedef struct {
+    uint16_t seq; // Counts every edge seen, including any that were dropped.
+    uint32_t t_edge; // Timestamp (us) of the edge, captured by CCP1.
+    uint16_t latency; // Time (us) from edge to latching the encoders.
+    uint16_t a; // Raw encoder values.
+    uint16_t b;
+} trigger_record_t;
+
+void trigger_init(void);
+void trigger_close(void);
+uint8_t trigger_edge_pending(void);
+void trigger_push(uint16_t a, uint16_t b, uint32_t t_latch);
+uint8_t trigger_pop(trigger_record_t* rec);
+uint16_t trigger_get_dropped(void);
+uint16_t trigger_get_edge_count(void);
+
+#endif
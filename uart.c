@@ -9,16 +9,80 @@
 // 2019-04-15 PIC16F18426
 // 2023-02-03 PIC18F26Q10 for magnetic encoder readout
 // 2023-03-03 change to linking with C99 library
+// 2026-10-18 interrupt-driven receive buffer for command lines
+//            baud rates to 2Mbaud with error check, auto-baud
+//            timestamp line ends received under interrupt (needs timestamp.c)
+//            RTS/CTS can be turned off, for hosts that do not drive RTS
 
 #include <xc.h>
 #include "global_defs.h"
+#include "clock.h"
 #include "uart.h"
+#include "timestamp.h"
 #include <stdio.h>
 // #include <conio.h> // no longer used for C99
 
-void uart1_init(long baud)
+// Receive buffer, filled by the interrupt service routine.
+#define RX_BUFLEN 32
+static volatile char rx_buf[RX_BUFLEN];
+static volatile uint8_t rx_head = 0; // Written only by the ISR.
+static volatile uint8_t rx_tail = 0; // Written only by uart1_getc_nowait().
+static volatile uint16_t rx_dropped = 0; // characters lost to overflow
+static volatile uint32_t rx_eol_time = 0; // timestamp of the latest line end
+static uint8_t rx_in_line = 0;
+
+static long actual_baud = 0;
+static int16_t baud_error = 0; // in units of 0.01%
+static uint8_t flow_control = 1; // Wait for the host's RTS before sending.
+
+static long brg_for(long baud)
+{
+    // With BRG16=1 and BRGH=1, the rate is FOSC/(4*(SP1BRG+1)).
+    // For 32MHz, 115200 baud, expect value of 68.
+    //              9600 baud                 832.
+    return UART1_BRG_FOR(baud);
+}
+
+uint8_t uart1_check_baud(long baud, long* actual, int16_t* err)
+// Returns 1 if the clock cannot make this rate to within
+// UART1_MAX_BAUD_ERROR, otherwise 0 with the rate that we would
+// actually get and its error, in units of 0.01%.
+// At FOSC=32MHz, rates of 1Mbaud and 2Mbaud are exact while
+// 230400 is 0.8% slow and 460800 is 2.1% fast (and refused).
+{
+    long brg, e;
+    if (baud <= 0) return 1;
+    brg = brg_for(baud);
+    if (brg < 0 || brg > 65535) return 1;
+    *actual = (FOSC/4)/(brg + 1);
+    // Scale so that we stay within 32 bits, even at the extremes.
+    e = (*actual - baud)*100/(baud/100 + 1);
+    if (e > UART1_MAX_BAUD_ERROR || e < -UART1_MAX_BAUD_ERROR) return 1;
+    *err = (int16_t) e;
+    return 0;
+}
+
+uint8_t uart1_set_baud(long baud)
+// Returns 0 if the BRG has been set, or 1 if the rate was refused,
+// in which case the BRG is left as it was.
+{
+    long actual;
+    int16_t err;
+    if (uart1_check_baud(baud, &actual, &err)) return 1;
+    SP1BRG = (unsigned int) brg_for(baud);
+    actual_baud = actual;
+    baud_error = err;
+    return 0;
+}
+
+long uart1_get_actual_baud(void) { return actual_baud; }
+int16_t uart1_get_baud_error(void) { return baud_error; }
+
+uint8_t uart1_init(long baud)
+// Returns 1, without touching the EUSART, if the baud rate cannot be made.
 {
-    unsigned int brg_value;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    if (uart1_set_baud(baud)) return 1;
     // Configure PPS MCU_RX=RC7, MCU_TX=RC6 
     GIE = 0;
     PPSLOCK = 0x55;
@@ -47,20 +111,76 @@ void uart1_init(long baud)
     TX1STAbits.SYNC = 0;
     BAUD1CONbits.BRG16 = 1;
     TX1STAbits.BRGH = 1;
-    brg_value = (unsigned int) (FOSC/baud/4 - 1);
-    // For 32MHz, 115200 baud, expect value of 68.
-    //              9600 baud                 832.
-    SP1BRG = brg_value;
     TX1STAbits.TXEN = 1;
     RC1STAbits.CREN = 1;
     RC1STAbits.SPEN = 1;
-    return;
+    // If the receive interrupt is already in use, we are clear to send.
+    if (PIE3bits.RC1IE) { LATCbits.LATC5 = 0; }
+    INTCONbits.GIE = GIEBitValue;
+    return 0;
+}
+
+void uart1_set_flow_control(uint8_t on)
+{
+    // Without it, we send regardless of RTS, and the host
+    // must keep up; CTS is still driven, for hosts that use it.
+    flow_control = on;
+}
+
+uint8_t uart1_get_flow_control(void) { return flow_control; }
+
+void uart1_wait_tx_done(void)
+{
+    NOP(); // Let the last character move to the shift register.
+    while (!TX1STAbits.TRMT) { CLRWDT(); }
+}
+
+uint8_t uart1_autobaud(uint16_t timeout_ms)
+// Measure the host's baud rate from a 'U' (0x55) character.
+// Returns 1 if the BRG has been set from the measurement,
+// or 0 if nothing arrived in time (or the measurement overflowed),
+// in which case the previous rate is restored.
+{
+    uint16_t saved_brg = SP1BRG;
+    uint8_t saved_rcie = PIE3bits.RC1IE;
+    uint8_t ok = 0;
+    char c_discard;
+    long actual;
+    // Keep the character away from the receive buffer.
+    PIE3bits.RC1IE = 0;
+    uart1_flush_rx();
+    BAUD1CONbits.ABDOVF = 0;
+    BAUD1CONbits.ABDEN = 1;
+    // Let the PC/Host know that it is clear to send.
+    LATCbits.LATC5 = 0;
+    while (BAUD1CONbits.ABDEN && timeout_ms) {
+        __delay_ms(1); CLRWDT(); --timeout_ms;
+    }
+    if (BAUD1CONbits.ABDEN || BAUD1CONbits.ABDOVF) {
+        BAUD1CONbits.ABDEN = 0;
+        BAUD1CONbits.ABDOVF = 0;
+        SP1BRG = saved_brg;
+    } else {
+        actual = (FOSC/4)/((long)SP1BRG + 1);
+        baud_error = 0; // as far as we can tell
+        actual_baud = actual;
+        ok = 1;
+    }
+    // The measured character is received as junk.
+    while (PIR3bits.RC1IF) { c_discard = RC1REG; }
+    uart1_flush_rx();
+    LATCbits.LATC5 = 1;
+    if (saved_rcie) {
+        PIE3bits.RC1IE = 1;
+        LATCbits.LATC5 = 0;
+    }
+    return ok;
 }
 
 void putch(char data)
 {
     // Wait until PC/Host is requesting.
-    while (PORTCbits.RC2) { CLRWDT(); }
+    while (flow_control && PORTCbits.RC2) { CLRWDT(); }
     // Wait until shift-register empty, then send data.
     while (!TX1STAbits.TRMT) { CLRWDT(); }
     TX1REG = data;
@@ -132,8 +252,83 @@ char getche(void)
     return data;
 }
 
+void uart1_enable_rx_interrupt(void)
+{
+    // From here on, received characters are collected by the
+    // interrupt service routine rather than by getch().
+    uart1_flush_rx();
+    rx_head = 0; rx_tail = 0;
+    PIE3bits.RC1IE = 1;
+    // Let the PC/Host know that it is clear to send.
+    LATCbits.LATC5 = 0;
+}
+
+void uart1_service_irq(void)
+{
+    // To be called from the interrupt service routine.
+    if (!(PIE3bits.RC1IE && PIR3bits.RC1IF)) return;
+    char c = RC1REG;
+    // Clear possible overflow error.
+    if (RC1STAbits.OERR) {
+        RC1STAbits.CREN = 0;
+        NOP();
+        RC1STAbits.CREN = 1;
+        rx_dropped++;
+    }
+    uint8_t next = (rx_head + 1) & (RX_BUFLEN - 1);
+    if (next == rx_tail) { rx_dropped++; return; } // Buffer full; discard.
+    rx_buf[rx_head] = c;
+    rx_head = next;
+    // Note when each line ends, for the host's time-sync exchange.
+    // Only the first of \r\n counts.
+    if (c == '\r' || c == '\n') {
+        if (rx_in_line) { rx_eol_time = timestamp_now(); rx_in_line = 0; }
+    } else {
+        rx_in_line = 1;
+    }
+    // The host may send a couple more characters after we
+    // deassert CTS, so we stop it while there is still room.
+    if (((rx_tail - rx_head) & (RX_BUFLEN - 1)) < 8) {
+        LATCbits.LATC5 = 1;
+    }
+}
+
+uint16_t uart1_get_rx_dropped(void) { return rx_dropped; }
+
+uint32_t uart1_get_rx_eol_time(void)
+// Returns the timestamp (us) at which the latest line from the host ended.
+{
+    uint32_t t;
+    uint8_t GIEBitValue = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    t = rx_eol_time;
+    INTCONbits.GIE = GIEBitValue;
+    return t;
+}
+
+int uart1_peekc_nowait(void)
+// Returns the next received character, leaving it to be read,
+// or -1 if there is none.
+{
+    if (rx_tail == rx_head) return -1;
+    return (int)rx_buf[rx_tail];
+}
+
+int uart1_getc_nowait(void)
+// Returns the next received character or -1 if there is none.
+{
+    if (rx_tail == rx_head) return -1;
+    char c = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & (RX_BUFLEN - 1);
+    if (((rx_tail - rx_head) & (RX_BUFLEN - 1)) >= 8 || rx_tail == rx_head) {
+        LATCbits.LATC5 = 0;
+    }
+    return (int)c;
+}
+
 void uart1_close(void)
 {
+    PIE3bits.RC1IE = 0;
     TX1STAbits.TXEN = 0;
     RC1STAbits.CREN = 0;
     RC1STAbits.SPEN = 0;
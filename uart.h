@@ -3,12 +3,30 @@
 
 #ifndef MY_UART
 #define MY_UART
-void uart1_init(long baud);
+#include <stdint.h>
+// Largest acceptable baud-rate error, in units of 0.01%.
+#define UART1_MAX_BAUD_ERROR 200
+
+uint8_t uart1_init(long baud);
+uint8_t uart1_check_baud(long baud, long* actual, int16_t* err);
+uint8_t uart1_set_baud(long baud);
+void uart1_set_flow_control(uint8_t on);
+uint8_t uart1_get_flow_control(void);
+void uart1_wait_tx_done(void);
+long uart1_get_actual_baud(void);
+int16_t uart1_get_baud_error(void);
+uint8_t uart1_autobaud(uint16_t timeout_ms);
 void putch(char data);
 __bit kbhit(void);
 void uart1_flush_rx(void);
 int getch(void);
 char getche(void);
+void uart1_enable_rx_interrupt(void);
+void uart1_service_irq(void);
+int uart1_getc_nowait(void);
+int uart1_peekc_nowait(void);
+uint16_t uart1_get_rx_dropped(void);
+uint32_t uart1_get_rx_eol_time(void);
 void uart1_close(void);
 
 #define XON 0x11